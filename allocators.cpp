@@ -50,3 +50,751 @@ void producer()
      }
 }
 
+/************
+ * @fixed-size-pool
+ ************/
+
+// A synchronized_pool_resource takes a lock for every allocation and deallocation,
+// so with many producers and consumers, the pool itself becomes the point of contention.
+// For blocks of a single fixed size, we can do better:
+// each thread keeps a small cache of free blocks and only rarely goes to a lock-free global free list.
+// The memory is obtained from the upstream resource in large chunks that are released only when the pool is destroyed.
+struct Block_cache;
+
+class Fixed_pool_resource : public pmr::memory_resource {
+public:
+    explicit Fixed_pool_resource(size_t block_size, pmr::memory_resource* upstream = pmr::new_delete_resource());
+    ~Fixed_pool_resource();
+
+    Fixed_pool_resource(const Fixed_pool_resource&) = delete;
+    Fixed_pool_resource& operator=(const Fixed_pool_resource&) = delete;
+
+    size_t block_size() const { return bsz; }
+private:
+    // Requests that don't fit in a block are passed on to upstream
+    void* do_allocate(size_t bytes, size_t align) override;
+    void do_deallocate(void* p, size_t bytes, size_t align) override;
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this==&other; }
+
+    bool fits(size_t bytes, size_t align) const { return bytes<=bsz && align<=alignof(max_align_t); }
+
+    // The global free list is a stack of block indices. 
+    // Its head holds an index and a tag that changes with every update,
+    // so that a thread that was preempted in the middle of a pop can't be fooled 
+    // by the head having been popped and pushed back in the meantime (the ABA problem).
+    static constexpr uint32_t none = 0;     // index+1 is stored, so 0 means "no block"
+    static uint64_t pack(uint32_t index, uint32_t tag) { return uint64_t(tag)<<32 | index; }
+    static uint32_t index_of(uint64_t h) { return uint32_t(h); }
+    static uint32_t tag_of(uint64_t h) { return uint32_t(h>>32); }
+
+    byte* block(uint32_t index) const;      // the block with a given index
+    uint32_t index(void* p) const;          // the index of a block
+    atomic<uint32_t>& next(uint32_t index) const;       // the link of a free block
+
+    int pop(void** out, int n);             // take up to n blocks from the global free list
+    void push(uint32_t first, uint32_t last);   // put a chain of linked blocks onto the global free list
+    void* refill();                         // get a new chunk from upstream
+
+    friend struct Block_cache;
+    friend Block_cache* cache_for(Fixed_pool_resource* r);
+    static constexpr int cache_size = 64;   // per thread
+    void release(void** p, int n);          // return n cached blocks to the global free list
+    void attach(Block_cache* c);            // c now caches blocks of this pool
+    void detach_caches();                   // make every cache forget this pool
+
+    // The caches holding our blocks, so that we can detach them when we are destroyed.
+    // One mutex for all pools: a thread exiting and a pool being destroyed must agree on whether the pool is still there.
+    static inline mutex registry;
+    vector<Block_cache*> caches;            // guarded by registry
+
+    size_t bsz;                             // block size
+    size_t chunk_bytes;                     // a power of two; chunks are aligned to it
+    uint32_t header_blocks;                 // room for the chunk's header at the start of each chunk
+    uint32_t blocks_per_chunk;              // not counting the header blocks
+    pmr::memory_resource* up;
+
+    static constexpr int max_chunks = 1<<16;
+    unique_ptr<atomic<byte*>[]> chunks;     // chunks[i] is the i'th chunk
+    atomic<int> nchunks {0};
+    mutex grow_mutex;                       // taken only when we need a new chunk
+
+    atomic<uint64_t> head {pack(none,0)};
+};
+
+// Each chunk starts with a header telling which chunk it is, followed by the links of its blocks.
+// Chunks are aligned to their size, so the chunk of a block can be found by masking the block's address.
+// The links are kept out of the blocks themselves: a thread may read the link of a block that another thread
+// has just popped and is filling with data, and that must not be a data race.
+struct Chunk_header {
+    uint32_t id;
+    atomic<uint32_t>* links() { return reinterpret_cast<atomic<uint32_t>*>(this+1); }  // one per block
+};
+
+Fixed_pool_resource::Fixed_pool_resource(size_t block_size, pmr::memory_resource* upstream)
+    :bsz{(block_size+alignof(max_align_t)-1)/alignof(max_align_t)*alignof(max_align_t)},
+     chunk_bytes{bit_ceil(64*bsz)},
+     up{upstream},
+     chunks{new atomic<byte*>[max_chunks]}
+{
+    // The header and the links of the remaining blocks must fit into the header blocks
+    const uint32_t total = chunk_bytes/bsz;
+    header_blocks = 1;
+    while (header_blocks*bsz<sizeof(Chunk_header)+(total-header_blocks)*sizeof(atomic<uint32_t>))
+        ++header_blocks;
+    blocks_per_chunk = total-header_blocks;
+}
+
+Fixed_pool_resource::~Fixed_pool_resource()
+{
+    detach_caches();
+    for (int i = 0; i!=nchunks; ++i)
+        up->deallocate(chunks[i],chunk_bytes,chunk_bytes);
+}
+
+byte* Fixed_pool_resource::block(uint32_t index) const
+{
+    const uint32_t i = index-1;
+    return chunks[i/blocks_per_chunk].load(memory_order_relaxed)+(header_blocks+i%blocks_per_chunk)*bsz;
+}
+
+uint32_t Fixed_pool_resource::index(void* p) const
+{
+    auto a = reinterpret_cast<uintptr_t>(p);
+    auto base = a & ~uintptr_t(chunk_bytes-1);
+    auto h = reinterpret_cast<Chunk_header*>(base);
+    return h->id*blocks_per_chunk+(a-base)/bsz-header_blocks+1;   // block k of the chunk has index k+1
+}
+
+atomic<uint32_t>& Fixed_pool_resource::next(uint32_t index) const
+{
+    const uint32_t i = index-1;
+    auto h = reinterpret_cast<Chunk_header*>(chunks[i/blocks_per_chunk].load(memory_order_relaxed));
+    return h->links()[i%blocks_per_chunk];
+}
+
+// A pop reads the link of the head block even if another thread has just popped that block.
+// The value read may then be out of date, but the tag has changed, so the compare_exchange fails and we try again.
+// The chunks are never returned upstream while the pool exists, so the read is always of memory we own.
+// To take several blocks with one compare_exchange, we follow the links from the head first.
+// Only a change of the head can change the links of the blocks on the list,
+// so if the head (and its tag) is still what we started from, the chain we followed is still on the list.
+int Fixed_pool_resource::pop(void** out, int n)
+{
+    uint64_t h = head.load(memory_order_acquire);
+    while (index_of(h)!=none) {
+        int k = 0;
+        uint32_t i = index_of(h);
+        while (k!=n && i!=none) {
+            out[k++] = block(i);
+            i = next(i).load(memory_order_relaxed);
+        }
+        if (head.compare_exchange_weak(h,pack(i,tag_of(h)+1),memory_order_acquire,memory_order_acquire))
+            return k;
+    }
+    return 0;
+}
+
+void Fixed_pool_resource::push(uint32_t first, uint32_t last)
+{
+    uint64_t h = head.load(memory_order_relaxed);
+    do {
+        next(last).store(index_of(h),memory_order_relaxed);
+    } while (!head.compare_exchange_weak(h,pack(first,tag_of(h)+1),memory_order_release,memory_order_relaxed));
+}
+
+void* Fixed_pool_resource::refill()
+{
+    scoped_lock lck {grow_mutex};
+    if (void* p; pop(&p,1))                 // someone else got there first
+        return p;
+    const int id = nchunks.load();
+    if (id==max_chunks)
+        throw bad_alloc{};
+    byte* c = static_cast<byte*>(up->allocate(chunk_bytes,chunk_bytes));
+    auto ch = new(c) Chunk_header{uint32_t(id)};
+    for (uint32_t k = 0; k!=blocks_per_chunk; ++k)
+        new(ch->links()+k) atomic<uint32_t>{none};
+    chunks[id].store(c,memory_order_relaxed);
+    nchunks.store(id+1,memory_order_release);
+
+    // keep the first block for the caller and put the rest on the free list
+    const uint32_t first = id*blocks_per_chunk+1;
+    const uint32_t last = first+blocks_per_chunk-1;
+    for (uint32_t i = first+1; i!=last; ++i)
+        next(i).store(i+1,memory_order_relaxed);
+    if (first!=last)
+        push(first+1,last);
+    return block(first);
+}
+
+// The per-thread cache: a few blocks for each pool the thread uses.
+// When the thread exits, its cached blocks are given back to their pool.
+// When a pool is destroyed first, it detaches the caches holding its blocks:
+// their blocks are gone with the pool's chunks, and the slot is free for another pool
+// (even one that happens to be constructed at the same address).
+struct Block_cache {
+    atomic<Fixed_pool_resource*> owner {nullptr};   // set by our thread; reset by the owner's destructor
+    void* blocks[Fixed_pool_resource::cache_size];
+    int n = 0;
+
+    ~Block_cache()
+    {
+        scoped_lock lck {Fixed_pool_resource::registry};
+        if (Fixed_pool_resource* r = owner.load(memory_order_relaxed)) {
+            r->release(blocks,n);
+            erase(r->caches,this);
+        }
+    }
+};
+
+thread_local Block_cache block_caches[4];   // a thread rarely uses more than a few pools at a time
+
+Block_cache* cache_for(Fixed_pool_resource* r)
+{
+    Block_cache* unused = nullptr;
+    for (auto& c : block_caches) {
+        Fixed_pool_resource* o = c.owner.load(memory_order_relaxed);
+        if (o==r)
+            return &c;
+        if (o==nullptr && !unused)
+            unused = &c;
+    }
+    if (unused)
+        r->attach(unused);
+    return unused;                          // nullptr: too many pools; use the global free list directly
+}
+
+void Fixed_pool_resource::attach(Block_cache* c)
+{
+    scoped_lock lck {registry};
+    c->n = 0;                               // any blocks left from a destroyed pool are gone
+    c->owner.store(this,memory_order_relaxed);
+    caches.push_back(c);
+}
+
+void Fixed_pool_resource::detach_caches()
+{
+    scoped_lock lck {registry};
+    for (Block_cache* c : caches)
+        c->owner.store(nullptr,memory_order_relaxed);
+    caches.clear();
+}
+
+void Fixed_pool_resource::release(void** p, int n)
+{
+    if (n==0)
+        return;
+    for (int i = 0; i!=n-1; ++i)            // link the blocks into a chain
+        next(index(p[i])).store(index(p[i+1]),memory_order_relaxed);
+    push(index(p[0]),index(p[n-1]));
+}
+
+void* Fixed_pool_resource::do_allocate(size_t bytes, size_t align)
+{
+    if (!fits(bytes,align))
+        return up->allocate(bytes,align);
+    Block_cache* c = cache_for(this);
+    if (!c) {
+        if (void* p; pop(&p,1))
+            return p;
+        return refill();
+    }
+    if (c->n)
+        return c->blocks[--c->n];           // the common case: no atomic operations at all
+    c->n = pop(c->blocks,cache_size/2);     // a miss: take a batch, so that the next misses are rare
+    if (c->n)
+        return c->blocks[--c->n];
+    return refill();
+}
+
+void Fixed_pool_resource::do_deallocate(void* p, size_t bytes, size_t align)
+{
+    if (!fits(bytes,align)) {
+        up->deallocate(p,bytes,align);
+        return;
+    }
+    Block_cache* c = cache_for(this);
+    if (!c) {
+        release(&p,1);
+        return;
+    }
+    if (c->n==cache_size) {                 // full: give half back, so that other threads can use them
+        release(c->blocks+cache_size/2,cache_size/2);
+        c->n = cache_size/2;
+    }
+    c->blocks[c->n++] = p;
+}
+
+// A consumer thread frees the Events made by a producer thread,
+// so blocks flow from the consumers' caches, through the global free list, to the producers' caches,
+// half a cache at a time in each direction: one compare_exchange on the global head per cache_size/2 blocks.
+
+// The Events use it exactly as they used the synchronized_pool_resource.
+// The Event data and the small objects (list nodes and shared_ptr control blocks) get separate pools,
+// so that a list node doesn't occupy a 2K block:
+Fixed_pool_resource data_pool {512*sizeof(int)};
+Fixed_pool_resource node_pool {128};
+
+struct Event {
+     pmr::vector<int> data = pmr::vector<int>(512,&data_pool);
+};
+
+pmr::list<shared_ptr<Event>> q {&node_pool};
+
+void producer()
+{
+     for (int n = 0; n!=LOTS; ++n) {
+           auto e = allocate_shared<Event>(pmr::polymorphic_allocator<Event>{&node_pool});    // outside the lock
+           scoped_lock lk {m};
+           q.push_back(e);
+           cv.notify_one();
+     }
+}
+
+// To compare, run producers and consumers with each resource and look at throughput and at the memory the process holds.
+// Resident memory much larger than the live Events is a sign of fragmentation.
+long resident_kb()
+{
+    ifstream statm {"/proc/self/statm"};
+    long size = 0;
+    long resident = 0;
+    statm >> size >> resident;
+    return resident*(sysconf(_SC_PAGESIZE)/1024);
+}
+
+void event_benchmark(const char* name, pmr::memory_resource* data_res, pmr::memory_resource* node_res,
+                     int producers, int consumers, int events)
+{
+    struct Ev {
+        pmr::vector<int> data;
+    };
+    pmr::list<shared_ptr<Ev>> queue {node_res};
+    mutex qm;
+    condition_variable qcv;
+    atomic<int> consumed {0};
+    const int total = producers*(events/producers);
+
+    auto t0 = high_resolution_clock::now();
+    vector<thread> threads;
+    for (int p = 0; p!=producers; ++p)
+        threads.emplace_back([&] {
+            for (int n = 0; n!=events/producers; ++n) {
+                auto e = allocate_shared<Ev>(pmr::polymorphic_allocator<Ev>{node_res},pmr::vector<int>(512,data_res));
+                scoped_lock lk {qm};
+                queue.push_back(std::move(e));
+                qcv.notify_one();
+            }
+        });
+    for (int c = 0; c!=consumers; ++c)
+        threads.emplace_back([&] {
+            while (true) {
+                unique_lock lk {qm};
+                qcv.wait(lk,[&] { return !queue.empty() || consumed==total; });
+                if (queue.empty())
+                    return;
+                auto e = std::move(queue.front());
+                queue.pop_front();
+                if (++consumed==total)
+                    qcv.notify_all();
+                lk.unlock();
+                e.reset();                  // the consumer frees the Event
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+    auto t1 = high_resolution_clock::now();
+    cout << name << ": " << total/(duration_cast<microseconds>(t1-t0).count()/1e6) << " events/s, "
+         << resident_kb() << "KB resident\n";
+}
+
+void compare_pools()
+{
+    {
+        pmr::synchronized_pool_resource pool;
+        event_benchmark("synchronized_pool_resource",&pool,&pool,8,8,1'000'000);
+    }
+    {
+        Fixed_pool_resource data {512*sizeof(int)};
+        Fixed_pool_resource nodes {128};
+        event_benchmark("Fixed_pool_resource",&data,&nodes,8,8,1'000'000);
+    }
+}
+// Run each configuration in its own process if you want resident sizes that are not affected by the previous run.
+
+/************
+ * @recycling
+ ************/
+
+// Even with a good pool, each message still constructs an Event – zeroing its 512 ints – only for a consumer to destroy it.
+// If Events are used over and over, we don't need to destroy them at all:
+// a consumer that is done with an Event gives it back, and a producer reuses it as is.
+// The handle is a unique_ptr whose deleter returns the Event to the pool rather than deleting it,
+// so an Event is still released automatically when its last user is done with it.
+class Event_pool {
+public:
+    struct Recycle {                     // "delete" an Event by giving it back to its pool
+        Event_pool* pool;
+        void operator()(Event* e) const { pool->put(e); }
+    };
+    using Handle = unique_ptr<Event,Recycle>;
+
+    explicit Event_pool(int n = 0);      // start with n Events
+    ~Event_pool();
+
+    Event_pool(const Event_pool&) = delete;
+    Event_pool& operator=(const Event_pool&) = delete;
+
+    Handle get();                        // a recycled Event, or a new one if none is free
+private:
+    void put(Event* e);
+
+    mutex mtx;                           // held only to push or pop a pointer
+    vector<Event*> free;
+};
+
+Event_pool::Event_pool(int n)
+{
+    free.reserve(n);
+    for (int i = 0; i!=n; ++i)
+        free.push_back(new Event);
+}
+
+// A pool must outlive its Handles; when it goes, it deletes the Events that were given back
+Event_pool::~Event_pool()
+{
+    for (Event* e : free)
+        delete e;
+}
+
+Event_pool::Handle Event_pool::get()
+{
+    {
+        scoped_lock lck {mtx};
+        if (!free.empty()) {
+            Event* e = free.back();
+            free.pop_back();
+            return Handle{e,Recycle{this}};    // note: e->data still holds the previous contents
+        }
+    }
+    return Handle{new Event,Recycle{this}};    // construct outside the lock
+}
+
+void Event_pool::put(Event* e)
+{
+    scoped_lock lck {mtx};
+    free.push_back(e);                   // free has room unless the pool has grown since it was reserved
+}
+
+// The producer and consumer now exchange Handles.
+// The producer overwrites what it needs of the Event's data; it doesn't pay for zeroing what it doesn't need.
+Event_pool events {1000};
+pmr::list<Event_pool::Handle> q2 {&node_pool};
+
+void producer()
+{
+     for (int n = 0; n!=LOTS; ++n) {
+           auto e = events.get();        // no allocation, no constructor, once the pool is warm
+           // ... fill e->data ...
+           scoped_lock lk {m};
+           q2.push_back(std::move(e));
+           cv.notify_one();
+     }
+}
+
+void consumer()
+{
+     while (true) {
+           unique_lock lk {m};
+           cv.wait(lk,[] { return !q2.empty(); });
+           auto e = std::move(q2.front());
+           q2.pop_front();
+           lk.unlock();
+           // ... use e->data ...
+     }     // e is given back to events here
+}
+
+// Where an Event must be shared, a Handle converts to a shared_ptr, keeping its Recycle deleter;
+// the last shared_ptr gives the Event back:
+shared_ptr<Event> shared_event() { return events.get(); }
+
+/************
+ * @statistics
+ ************/
+
+// We adopted a pool because of fragmentation, so we'd better be able to see how well it works.
+// A memory_resource can wrap another and observe every allocation and deallocation on its way to the upstream resource.
+// Counting costs atomic operations on shared counters, so sampling can be turned on and off at run time.
+// The live bytes and the occupancy of each size class are always kept, so that they stay right whenever a block was allocated;
+// that is two atomic read-modify-writes per call, even with sampling off.
+// They are relaxed, but that doesn't make them cheap: every allocating thread writes the same two cache lines,
+// so under contention each operation waits for a line to move from another core – easily a hundred cycles or more.
+// We keep those counters on cache lines of their own, so that at least the sampling flag, read on every call,
+// and the peak and histogram are not dragged along. If the counting shows up in a profile,
+// the next step is to shard the counters per thread and add them up when reading.
+// Only the histogram and the peak depend on sampling, so they cover just the periods when it was on.
+class Stats_resource : public pmr::memory_resource {
+public:
+    explicit Stats_resource(pmr::memory_resource* upstream, bool on = true) :up{upstream}, sampling{on} {}
+
+    void sample(bool on) { sampling.store(on,memory_order_relaxed); }
+
+    static constexpr int classes = 32;       // size class k holds sizes in (2^(k-1):2^k]
+    static size_t class_size(int k) { return size_t(1)<<k; }
+
+    long long live_bytes() const { return live.load(memory_order_relaxed); }
+    long long peak_bytes() const { return peak.load(memory_order_relaxed); }
+    long long allocations(int k) const { return hist[k].load(memory_order_relaxed); }   // allocated in class k while sampling
+    long long occupancy(int k) const { return in_use[k].load(memory_order_relaxed); }   // currently allocated in class k
+
+    // A pool keeps the memory it has acquired, so at any time it holds roughly the peak.
+    // The part of that not currently in use is our estimate of fragmentation.
+    // A peak reached while sampling was off wasn't recorded, so the peak is at least what is live now:
+    double fragmentation() const
+    {
+        const long long l = live_bytes();
+        const long long p = max(peak_bytes(),l);
+        return p ? double(p-l)/p : 0;
+    }
+
+    void dump_json(ostream& os) const;
+private:
+    void* do_allocate(size_t bytes, size_t align) override;
+    void do_deallocate(void* p, size_t bytes, size_t align) override;
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this==&other; }
+
+    static int size_class(size_t bytes) { return min<int>(bit_width(bytes ? bytes-1 : 0),classes-1); }
+
+    pmr::memory_resource* up;
+    atomic<bool> sampling;                                   // read-mostly: shares a line only with up
+    alignas(64) atomic<long long> live {0};                  // written by every call
+    alignas(64) array<atomic<long long>,classes> in_use {};  // written by every call
+    alignas(64) atomic<long long> peak {0};                  // written only while sampling
+    array<atomic<long long>,classes> hist {};
+};
+
+void* Stats_resource::do_allocate(size_t bytes, size_t align)
+{
+    void* p = up->allocate(bytes,align);     // if this throws, there is nothing to count
+    const int k = size_class(bytes);
+    in_use[k].fetch_add(1,memory_order_relaxed);
+    const long long now = live.fetch_add(bytes,memory_order_relaxed)+bytes;
+    if (sampling.load(memory_order_relaxed)) {
+        hist[k].fetch_add(1,memory_order_relaxed);
+        long long old = peak.load(memory_order_relaxed);
+        while (old<now && !peak.compare_exchange_weak(old,now,memory_order_relaxed))
+            ;                                // someone else may have raised the peak meanwhile
+    }
+    return p;
+}
+
+void Stats_resource::do_deallocate(void* p, size_t bytes, size_t align)
+{
+    in_use[size_class(bytes)].fetch_sub(1,memory_order_relaxed);
+    live.fetch_sub(bytes,memory_order_relaxed);
+    up->deallocate(p,bytes,align);
+}
+
+// The counters are read one by one while other threads may be allocating, so a dump is a snapshot only approximately
+void Stats_resource::dump_json(ostream& os) const
+{
+    os << "{\"live_bytes\": " << live_bytes()
+       << ", \"peak_bytes\": " << peak_bytes()
+       << ", \"fragmentation\": " << fragmentation()
+       << ", \"size_classes\": [";
+    bool first = true;
+    for (int k = 0; k!=classes; ++k) {
+        if (allocations(k)==0 && occupancy(k)==0)
+            continue;
+        os << (first ? "" : ", ")
+           << "{\"max_size\": " << class_size(k)
+           << ", \"allocations\": " << allocations(k)
+           << ", \"occupancy\": " << occupancy(k) << '}';
+        first = false;
+    }
+    os << "]}\n";
+}
+
+// To watch the Event pool, put the statistics between the users and the pool:
+pmr::synchronized_pool_resource event_pool;
+Stats_resource event_stats {&event_pool};
+
+struct Event {
+     pmr::vector<int> data = pmr::vector<int>(512,&event_stats);
+};
+
+void report()
+{
+     event_stats.dump_json(cerr);       // e.g., from a signal handler thread or an admin endpoint
+}
+
+/************
+ * @numa
+ ************/
+
+// On a machine with several sockets, each socket has its own memory (a NUMA node), and
+// accessing another node's memory is slower.
+// A single pool hands out memory from wherever it was first touched, so 
+// a thread may get memory from the other node for every Event.
+// Instead, we can keep a pool per node and allocate from the pool of the node the calling thread runs on.
+
+// Where we are and how many nodes there are is a property of the machine, 
+// so we ask through an interface that a test can replace by a fake machine:
+class Topology {
+public:
+    virtual int nodes() const = 0;              // number of NUMA nodes
+    virtual int current_node() const = 0;       // the node the calling thread is running on
+    virtual ~Topology() = default;
+};
+
+class Linux_topology : public Topology {
+public:
+    Linux_topology()
+    {
+        n = 0;
+        while (filesystem::exists("/sys/devices/system/node/node"+to_string(n)))
+            ++n;
+        n = max(n,1);                           // no NUMA information: one node
+    }
+    int nodes() const override { return n; }
+    int current_node() const override
+    {
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (syscall(SYS_getcpu,&cpu,&node,nullptr)!=0 || n<=int(node))
+            return 0;
+        return node;
+    }
+private:
+    int n;
+};
+
+// A fake machine: each thread says which node it pretends to run on
+class Fake_topology : public Topology {
+public:
+    explicit Fake_topology(int n) :n{n} {}
+    int nodes() const override { return n; }
+    int current_node() const override
+    {
+        if (node<0 || n<=node)
+            throw out_of_range{"Fake_topology: no node "+to_string(node)};
+        return node;
+    }
+    static inline thread_local int node = 0;
+private:
+    int n;
+};
+
+// The memory for a node's pool comes directly from the operating system, bound to that node.
+// The pool asks for large chunks, so a system call per chunk is affordable.
+// If binding fails (e.g., on a machine without NUMA support), we still get memory, just not bound.
+class Node_resource : public pmr::memory_resource {
+public:
+    explicit Node_resource(int node) :node{node} {}
+private:
+    void* do_allocate(size_t bytes, size_t align) override
+    {
+        if (sysconf(_SC_PAGESIZE)<long(align))
+            throw bad_alloc{};                  // mmap() gives page alignment only
+        void* p = mmap(nullptr,bytes,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+        if (p==MAP_FAILED)
+            throw bad_alloc{};
+        constexpr int mpol_preferred = 1;       // from <numaif.h>: prefer this node, but don't fail if it is full
+        unsigned long mask = 1ul<<node;
+        syscall(SYS_mbind,p,bytes,mpol_preferred,&mask,sizeof(mask)*8,0);
+        return p;
+    }
+    void do_deallocate(void* p, size_t bytes, size_t) override { munmap(p,bytes); }
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this==&other; }
+
+    int node;
+};
+
+class Numa_pool_resource : public pmr::memory_resource {
+public:
+    explicit Numa_pool_resource(const Topology& t);
+
+    long long blocks(int node) const { return counts[node].n.load(memory_order_relaxed); }  // currently allocated from node's pool
+private:
+    void* do_allocate(size_t bytes, size_t align) override;
+    void do_deallocate(void* p, size_t bytes, size_t align) override;
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this==&other; }
+
+    // A block must go back to the pool it came from, but the thread freeing it may run on another node,
+    // so we keep the node number in a header in front of the block.
+    static size_t header(size_t align) { return max(align,alignof(max_align_t)); }
+
+    const Topology& topo;
+    vector<unique_ptr<Node_resource>> node_memory;
+    vector<unique_ptr<pmr::synchronized_pool_resource>> pools;    // one per node
+
+    // One relaxed increment per allocation, on a counter of the node's own, in its own cache line
+    struct alignas(64) Count { atomic<long long> n {0}; };
+    unique_ptr<Count[]> counts;
+};
+
+Numa_pool_resource::Numa_pool_resource(const Topology& t)
+    :topo{t}, counts{make_unique<Count[]>(t.nodes())}
+{
+    for (int n = 0; n!=topo.nodes(); ++n) {
+        node_memory.push_back(make_unique<Node_resource>(n));
+        pools.push_back(make_unique<pmr::synchronized_pool_resource>(node_memory.back().get()));
+    }
+}
+
+void* Numa_pool_resource::do_allocate(size_t bytes, size_t align)
+{
+    if (pools.size()==1) {                      // a single node: just a pool, no headers
+        void* p = pools[0]->allocate(bytes,align);
+        counts[0].n.fetch_add(1,memory_order_relaxed);
+        return p;
+    }
+    const int n = topo.current_node();
+    const size_t h = header(align);
+    byte* p = static_cast<byte*>(pools[n]->allocate(bytes+h,align));
+    counts[n].n.fetch_add(1,memory_order_relaxed);
+    *reinterpret_cast<int*>(p) = n;
+    return p+h;
+}
+
+void Numa_pool_resource::do_deallocate(void* p, size_t bytes, size_t align)
+{
+    if (pools.size()==1) {
+        pools[0]->deallocate(p,bytes,align);
+        counts[0].n.fetch_sub(1,memory_order_relaxed);
+        return;
+    }
+    const size_t h = header(align);
+    byte* b = static_cast<byte*>(p)-h;
+    const int n = *reinterpret_cast<int*>(b);
+    pools[n]->deallocate(b,bytes+h,align);
+    counts[n].n.fetch_sub(1,memory_order_relaxed);
+}
+
+// The event queue uses it like any other pool:
+Linux_topology machine;
+Numa_pool_resource numa_pool {machine};
+
+struct Event {
+     pmr::vector<int> data = pmr::vector<int>(512,&numa_pool);    // memory from the producer's node
+};
+
+// Allocating on the producer's node helps consumers only if they run on the same node,
+// so run a producer and its consumers per node (pinned to that node's cores), each with their own queue.
+
+// On a single-node machine, we can still check that blocks go to and come back from the right pools by pretending:
+void numa_check()
+{
+    Fake_topology fake {2};
+    Numa_pool_resource pool {fake};
+    pmr::vector<int> v0(512,&pool);            // from node 0's pool
+    assert(pool.blocks(0)==1 && pool.blocks(1)==0);
+    thread t {[&] {
+        Fake_topology::node = 1;
+        pmr::vector<int> v1(512,&pool);        // from node 1's pool
+        assert(pool.blocks(0)==1 && pool.blocks(1)==1);
+        v0 = pmr::vector<int>(1024,&pool);     // v0's old elements go back to node 0's pool; the new ones come from node 1's
+        assert(pool.blocks(0)==0 && pool.blocks(1)==2);
+    }};
+    t.join();
+    assert(pool.blocks(0)==0 && pool.blocks(1)==1);    // v1 went back to node 1's pool
+}
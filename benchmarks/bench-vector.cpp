@@ -0,0 +1,187 @@
+// @benchmark @vector @containers
+// A micro-benchmark harness for comparing the Vectors in this tree with each other and with std::vector.
+// Build and run (the result is JSON on cout, progress on cerr):
+//     g++ -std=c++20 -O2 bench-vector.cpp ../separate-compilation/Vector.cpp -o bench_vector
+//     ./bench_vector >results.json
+// Each case is run a few times to warm up caches and the allocator, then timed repeatedly;
+// we report percentiles rather than a mean, because a single page fault or context switch can skew a mean.
+// Where the kernel lets us, we also count cycles and instructions (perf_event_open);
+// in many containers that is not permitted and the counters are simply left out.
+#include "../separate-compilation/Vector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+// A hardware counter for the calling thread; valid() is false if the kernel refused to give us one
+class Perf_counter {
+public:
+    explicit Perf_counter(unsigned long long config)
+    {
+        perf_event_attr attr;
+        memset(&attr,0,sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open,&attr,0,-1,-1,0);
+    }
+    ~Perf_counter() { if (valid()) close(fd); }
+    Perf_counter(const Perf_counter&) = delete;
+    Perf_counter& operator=(const Perf_counter&) = delete;
+
+    bool valid() const { return 0<=fd; }
+    void start() { if (valid()) { ioctl(fd,PERF_EVENT_IOC_RESET,0); ioctl(fd,PERF_EVENT_IOC_ENABLE,0); } }
+    long long stop()
+    {
+        long long n = 0;
+        if (valid()) {
+            ioctl(fd,PERF_EVENT_IOC_DISABLE,0);
+            if (read(fd,&n,sizeof(n))!=sizeof(n))
+                n = 0;
+        }
+        return n;
+    }
+private:
+    int fd;
+};
+
+struct Result {
+    string container;
+    string operation;
+    int n;                       // number of elements
+    vector<long long> ns;        // one time per repetition, sorted
+    long long cycles = -1;       // per repetition; -1 if not available
+    long long instructions = -1;
+
+    long long percentile(int p) const { return ns[(ns.size()-1)*p/100]; }
+};
+
+struct Options {
+    int warmup = 3;
+    int repetitions = 31;
+};
+
+// Keep the compiler from optimizing away a result we don't otherwise use
+template<typename T>
+void keep(const T& x)
+{
+    asm volatile("" : : "r"(&x) : "memory");
+}
+
+template<typename F>
+Result measure(const string& container, const string& operation, int n, F f, const Options& opt)
+{
+    for (int i=0; i!=opt.warmup; ++i)
+        f();
+
+    Result r {container,operation,n,{}};      // no times yet
+    Perf_counter cycles {PERF_COUNT_HW_CPU_CYCLES};
+    Perf_counter instructions {PERF_COUNT_HW_INSTRUCTIONS};
+    long long total_cycles = 0;
+    long long total_instructions = 0;
+    for (int i=0; i!=opt.repetitions; ++i) {
+        cycles.start();
+        instructions.start();
+        auto t0 = steady_clock::now();
+        f();
+        auto t1 = steady_clock::now();
+        total_instructions += instructions.stop();
+        total_cycles += cycles.stop();
+        r.ns.push_back(duration_cast<nanoseconds>(t1-t0).count());
+    }
+    sort(r.ns.begin(),r.ns.end());
+    if (cycles.valid())
+        r.cycles = total_cycles/opt.repetitions;
+    if (instructions.valid())
+        r.instructions = total_instructions/opt.repetitions;
+    cerr << container << ' ' << operation << ' ' << n << ": " << r.percentile(50) << "ns\n";
+    return r;
+}
+
+// The cases: each is run only if the container supports the operations it needs.
+// Not every Vector in the tree has copy operations or push_back().
+template<typename V>
+void bench_container(const string& name, int n, const Options& opt, vector<Result>& results)
+{
+    results.push_back(measure(name,"construct",n,[n] { V v(n); keep(v); },opt));
+
+    if constexpr (requires(V v, double d) { v.push_back(d); })
+        results.push_back(measure(name,"push_back",n,[n] {
+            V v(0);
+            for (int i=0; i!=n; ++i)
+                v.push_back(i);
+            keep(v);
+        },opt));
+
+    V v(n);
+    for (int i=0; i!=n; ++i)
+        v[i] = i;
+
+    // Vector (from Vector.h) can't be copied, and so has no move operations either
+    if constexpr (is_copy_constructible_v<V>)
+        results.push_back(measure(name,"copy",n,[&v] { V c = v; keep(c); },opt));
+    if constexpr (is_move_constructible_v<V> && is_move_assignable_v<V>)
+        results.push_back(measure(name,"move",n,[&v] { V m = std::move(v); v = std::move(m); keep(v); },opt));   // two moves
+
+    results.push_back(measure(name,"subscript",n,[&v,n] {
+        double sum = 0;
+        for (int i=0; i!=n; ++i)
+            sum += v[i];
+        keep(sum);
+    },opt));
+
+    if constexpr (requires(V v) { v.begin(); v.end(); })
+        results.push_back(measure(name,"iterate",n,[&v] {
+            double sum = 0;
+            for (double x : v)
+                sum += x;
+            keep(sum);
+        },opt));
+}
+
+void write_json(ostream& os, const vector<Result>& results)
+{
+    os << "[\n";
+    for (size_t i=0; i!=results.size(); ++i) {
+        const Result& r = results[i];
+        os << "  {\"container\": \"" << r.container << "\", \"operation\": \"" << r.operation << "\", \"n\": " << r.n
+           << ", \"repetitions\": " << r.ns.size()
+           << ", \"min_ns\": " << r.ns.front() << ", \"p50_ns\": " << r.percentile(50)
+           << ", \"p90_ns\": " << r.percentile(90) << ", \"p99_ns\": " << r.percentile(99)
+           << ", \"max_ns\": " << r.ns.back();
+        if (0<=r.cycles)
+            os << ", \"cycles\": " << r.cycles;
+        if (0<=r.instructions)
+            os << ", \"instructions\": " << r.instructions;
+        os << '}' << (i+1==results.size() ? "" : ",") << '\n';
+    }
+    os << "]\n";
+}
+
+int main()
+{
+    Options opt;
+    vector<Result> results;
+    for (int n : {16,1'000,100'000,10'000'000}) {
+        bench_container<std::vector<double>>("std::vector<double>",n,opt,results);
+        bench_container<Vector>("separate-compilation Vector",n,opt,results);
+    }
+    write_json(cout,results);
+}
+
+// To add another Vector, make it visible here (e.g., by including its header) and call bench_container() for it.
@@ -93,9 +93,9 @@ double comp4(vector<double>& v)
      // spawn many tasks if v is large enough
 {
      if (v.size()<10000)      // is it worth using concurrency?
-           return accum(v.begin(),v.end(),0.0);
+           return accum(v.data(),v.data()+v.size(),0.0);
 
-     auto v0 = &v[0];
+     auto v0 = v.data();
      auto sz = v.size();
 
      auto f0 = async(accum,v0,v0+sz/4,0.0);          // first quarter
@@ -108,3 +108,217 @@ double comp4(vector<double>& v)
 
 // Please note that async() is not just a mechanism specialized for parallel computation for increased performance. 
 // For example, it can also be used to spawn a task for getting information from a user, leaving the “main program” active with something else
+
+/**************************
+ * @thread-pool
+ **************************/
+
+// Each call of comp4() may start four threads and then let them die.
+// For a vector of a few hundred thousand elements, that costs as much as the additions.
+// Using a Thread_pool (@thread-pool), the threads are started once and reused by every call,
+// and we can split the work by the number of workers rather than into a fixed four parts:
+double comp_pool(vector<double>& v, Thread_pool& pool = default_pool())
+{
+     const size_t min_chunk = 10000;                  // smaller chunks are not worth a task
+     if (v.size()<2*min_chunk)
+           return accum(v.data(),v.data()+v.size(),0.0);
+
+     const size_t n = min<size_t>(pool.size(),v.size()/min_chunk);   // one chunk per worker
+     auto v0 = v.data();
+     auto sz = v.size();
+
+     vector<Future<double>> fs;
+     for (size_t i = 1; i!=n; ++i)
+           fs.push_back(pool.submit([=] { return accum(v0+sz*i/n,v0+sz*(i+1)/n,0.0); }));
+
+     double sum = accum(v0,v0+sz/n,0.0);             // do the first chunk ourselves
+     for (auto& f : fs)
+           sum += f.get();                             // while waiting, get() runs other chunks
+     return sum;
+}
+
+// To see the difference, time many calls for a range of sizes:
+template<typename F>
+void time_comp(const char* name, F comp, size_t n, int calls)
+{
+     vector<double> v(n,1.0);
+     double sum = 0;
+     auto t0 = high_resolution_clock::now();
+     for (int i = 0; i!=calls; ++i)
+           sum += comp(v);
+     auto t1 = high_resolution_clock::now();
+     cout << name << ", " << n << " elements: "
+          << duration_cast<microseconds>(t1-t0).count()/calls << "usec per call (sum " << sum/calls << ")\n";
+}
+
+void comp_benchmark()
+{
+     for (size_t n : {20'000,100'000,1'000'000,10'000'000}) {
+           time_comp("comp4 (async)",comp4,n,100);
+           time_comp("comp_pool",[](vector<double>& v) { return comp_pool(v); },n,100);
+     }
+}
+// For small vectors the pool wins by the cost of starting threads;
+// for large ones, both are limited by memory bandwidth, and the pool wins only by using all the cores.
+
+/**************************
+ * @parallel-reduce
+ **************************/
+
+// comp2() always uses two threads and comp4() four, however many cores we have and however large v is.
+// comp_pool() uses every worker, but its minimum chunk size is a guess that is right only for adding doubles.
+// Better, let a general reduction decide:
+//  - the number of workers comes from the pool (a thread per core; see hardware_concurrency());
+//  - the cost of an element is measured by reducing a prefix of the range on the calling thread.
+// From those, we pick a grain size that makes each task worth its overhead
+// and cut the range into a few chunks per worker, so that stealing can even out the load.
+template<ranges::contiguous_range R, typename Op = plus<>>
+auto parallel_reduce(const R& r, ranges::range_value_t<R> init, Op op = {}, Thread_pool& pool = default_pool())
+{
+     using T = ranges::range_value_t<R>;
+     span<const T> s {ranges::data(r),ranges::size(r)};
+
+     const size_t probe = min<size_t>(s.size(),4096);
+     auto t0 = steady_clock::now();
+     T res = accumulate(s.begin(),s.begin()+probe,init,op);     // useful work, and a measurement
+     auto t1 = steady_clock::now();
+     s = s.subspan(probe);
+
+     const double task_ns = 20'000;            // a task should take much longer than the ~1us it costs to run it
+     const double element_ns = max(duration<double,nano>(t1-t0).count()/max<size_t>(probe,1),0.01);
+     const size_t grain = max<size_t>(task_ns/element_ns,1024);
+     const size_t n = min<size_t>(4*pool.size(),s.size()/grain);
+     if (n<2)
+           return accumulate(s.begin(),s.end(),res,op);        // not worth using concurrency
+
+     // Each chunk starts from its own first element, so we don't need an identity element for op
+     auto chunk = [=](size_t i) {
+           auto b = s.begin()+s.size()*i/n;
+           auto e = s.begin()+s.size()*(i+1)/n;
+           return accumulate(b+1,e,*b,op);
+     };
+     vector<Future<T>> fs;
+     for (size_t i = 1; i!=n; ++i)
+           fs.push_back(pool.submit([=] { return chunk(i); }));
+     res = op(res,chunk(0));
+     for (auto& f : fs)
+           res = op(res,f.get());                // combine in order: op need not be commutative
+     return res;
+}
+
+// The chunks depend on the number of workers and on a timing,
+// so for floating-point addition the rounding – and thus the result – can vary from run to run and from machine to machine.
+// When that matters, we can ask for a deterministic sum: the same input always gives the same result, in every bit.
+// For that, the blocks must not depend on the machine, and their sums must be combined in a fixed order:
+enum class Summation { fast, deterministic };
+
+// Kahan summation carries the rounding error of each addition along, so the sum of a block is also more accurate
+double kahan_sum(span<const double> s)
+{
+     double sum = 0;
+     double c = 0;                             // the low-order bits lost so far
+     for (double x : s) {
+           double y = x-c;
+           double t = sum+y;
+           c = (t-sum)-y;
+           sum = t;
+     }
+     return sum;
+}
+
+// Pairwise summation: the rounding error grows with the depth of the tree (log n) rather than with n
+double pairwise_sum(span<const double> s)
+{
+     if (s.size()<=2)
+           return accumulate(s.begin(),s.end(),0.0);
+     return pairwise_sum(s.first(s.size()/2))+pairwise_sum(s.subspan(s.size()/2));
+}
+
+template<ranges::contiguous_range R>
+     requires same_as<ranges::range_value_t<R>,double>
+double parallel_sum(const R& r, Summation how = Summation::fast, Thread_pool& pool = default_pool())
+{
+     if (how==Summation::fast)
+           return parallel_reduce(r,0.0,plus<>{},pool);
+
+     span<const double> s {ranges::data(r),ranges::size(r)};
+     const size_t block = 4096;                // fixed: not derived from the machine
+     const size_t nblocks = (s.size()+block-1)/block;
+     vector<double> partial(nblocks);
+
+     // How blocks are grouped into tasks may vary; the sum of each block does not
+     const size_t per_task = max<size_t>(nblocks/(4*pool.size()),1);
+     vector<Future<void>> fs;
+     for (size_t b = 0; b<nblocks; b += per_task)
+           fs.push_back(pool.submit([&,b] {
+                for (size_t k = b; k!=min(b+per_task,nblocks); ++k)
+                     partial[k] = kahan_sum(s.subspan(k*block,min(block,s.size()-k*block)));
+           }));
+     for (auto& f : fs)
+           f.get();
+     return pairwise_sum(partial);
+}
+
+// comp2() and comp4() become:
+double comp(vector<double>& v, Summation how = Summation::fast)
+{
+     return parallel_sum(v,how);
+}
+
+// The deterministic sum gives the same result whatever the number of threads; the fast one need not:
+void sum_check()
+{
+     vector<double> v(10'000'000);
+     mt19937_64 gen;
+     uniform_real_distribution<double> dist {-1e6,1e6};
+     for (auto& x : v)
+           x = dist(gen);
+
+     for (unsigned nthreads : {1,2,4,16}) {
+           Thread_pool pool {nthreads};
+           cout << setprecision(20) << nthreads << " threads: "
+                << "fast " << parallel_sum(v,Summation::fast,pool)
+                << ", deterministic " << parallel_sum(v,Summation::deterministic,pool) << '\n';
+     }
+}
+// The deterministic sum is slower: each Kahan step depends on the previous one, so the additions can't be vectorized.
+// Expect it to take about twice as long as the fast sum; use it where reproducibility is worth that.
+
+/**************************
+ * @continuations
+ **************************/
+
+// comp4() blocks in f0.get()+f1.get()+... and g() blocks in fx.get(); each wait ties up a thread.
+// With when_all() and then() (@continuations) we return a Future for the sum instead,
+// and no thread waits for the partial sums (v must of course outlive the computation):
+Future<double> comp_then(vector<double>& v, Thread_pool& pool = default_pool())
+{
+     auto v0 = v.data();
+     auto sz = v.size();
+     const size_t n = max<size_t>(min<size_t>(pool.size(),sz/10000),1);
+
+     vector<Future<double>> fs;
+     for (size_t i = 0; i!=n; ++i)
+           fs.push_back(pool.submit([=] { return accum(v0+sz*i/n,v0+sz*(i+1)/n,0.0); }));
+
+     return when_all(std::move(fs),pool).then([](Future<vector<Future<double>>> all) {
+           double sum = 0;
+           for (auto& f : all.get())
+                sum += f.get();                // all are ready: no waiting
+           return sum;
+     });
+}
+
+// Similarly, g() becomes a continuation of fx's task, run when the value (or exception) arrives:
+Future<void> g_then(Future<X> fx)
+{
+     return std::move(fx).then([](Future<X> f) {
+           try {
+                X v = f.get();                 // ready: doesn't wait
+                // ... use v ...
+           }
+           catch (...) {                       // oops: someone couldn't compute v
+                // ... handle error ...
+           }
+     });
+}
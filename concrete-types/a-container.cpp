@@ -16,15 +16,24 @@
 // Similarly, “naked delete operations” should be avoided. 
 // Avoiding naked new and naked delete makes code far less error-prone and far easier to keep free of resource leaks
 
+// Sometimes the elements are overwritten immediately after construction, for example by reading them from a file.
+// Then zeroing them first is a wasted pass over memory.
+// A tag type lets a user say “don’t initialize” explicitly, so that nobody gets uninitialized elements by accident:
+struct uninitialized_t { explicit uninitialized_t() = default; };
+constexpr uninitialized_t uninitialized {};
+
 class Vector {
 public:
     // Vector’s constructor allocates some memory on the free store (also called the heap or dynamic store) using the new operator.
-    Vector(int s) :elem{new double[s]}, sz{s}; // constructor: acquire resources
+    Vector(int s) :elem{new double[s]}, sz{s} // constructor: acquire resources
     {
-        for (int i=0; i!=s; ++i} // initialize elements
+        for (int i=0; i!=s; ++i) // initialize elements
             elem[i]=0;
     }
 
+    // new double[s] leaves the doubles uninitialized; the user promises to write every element before reading it.
+    Vector(int s, uninitialized_t) :elem{new double[s]}, sz{s} {}
+
     // The name of a destructor is the complement operator, ~, followed by the name of the class; it is the complement of a constructor.
     // The destructor cleans up by freeing that memory using the delete[] operator. 
     // Plain delete deletes an individual object, delete[] deletes an array.
@@ -32,11 +41,58 @@ public:
 
     double& operator[](int i);
     int size() const;
+
+    void resize_for_overwrite(int s);    // make room for s elements; their values are unspecified
 private:
     double* elem; // elem points to an array of sz doubles
     int sz;
 };
 
+// Unlike a resize(), resize_for_overwrite() neither keeps the old values nor initializes new ones:
+void Vector::resize_for_overwrite(int s)
+{
+    if (s==sz)
+        return;           // reuse the elements we have
+    double* p = new double[s];
+    delete[] elem;
+    elem = p;
+    sz = s;
+}
+
+// A bulk loader can now read straight into the elements.
+// If the read comes up short, some elements were never written, so we must not hand v back as if it were loaded:
+void load(istream& is, Vector& v, int n)
+{
+    v.resize_for_overwrite(n);
+    if (n==0)
+        return;           // there is no v[0] to read into
+    const streamsize bytes = n*sizeof(double);
+    is.read(reinterpret_cast<char*>(&v[0]),bytes);    // the only write to the elements
+    if (is.gcount()!=bytes)
+        throw runtime_error{"load(): short read"};
+}
+
+// To see the saved pass, time construction plus overwrite for both constructors.
+// The source is in memory, so that we measure memory bandwidth rather than the disk:
+template<typename Make>
+void time_overwrite(const char* name, const vector<double>& src, Make make)
+{
+    auto t0 = high_resolution_clock::now();
+    Vector v = make(src.size());
+    memcpy(&v[0],src.data(),src.size()*sizeof(double));
+    auto t1 = high_resolution_clock::now();
+    double bytes = src.size()*sizeof(double);
+    cout << name << ": " << bytes/duration_cast<nanoseconds>(t1-t0).count() << " GB/s\n";
+}
+
+void bandwidth_benchmark()
+{
+    vector<double> src(100'000'000,1.0);      // 800MB
+    time_overwrite("zeroed",src,[](int n) { return Vector(n); });
+    time_overwrite("uninitialized",src,[](int n) { return Vector(n,uninitialized); });
+}
+// Note that the first touch of a page is expensive whoever does it; what we save is the second pass.
+
 // Vector obeys the same rules for naming, scope, allocation, lifetime, etc., as does a built-in type.
 void fct(int n)
 {
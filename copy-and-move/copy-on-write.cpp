@@ -0,0 +1,156 @@
+// @copy @containers @copy-on-write @concurrency
+
+// Copying a Vector allocates and copies all its elements.
+// If copies are mostly read and rarely written, we can delay the copying until the first write:
+// copies share a representation and count its users, and a writer first makes its own copy (“detaches”).
+// That’s called copy-on-write. It makes copying O(1), but every write has to check whether the representation is shared.
+// So, rather than changing Vector, we provide it as a separate type that users opt into where the copies pay for the checks.
+class Cow_vector {
+private:
+    struct Rep {
+        atomic<int> uses;    // number of Cow_vectors sharing this Rep
+        int sz;
+        double* elem;        // elem points to an array of sz doubles
+    };
+    Rep* rep;
+
+    void release();          // stop using rep
+    void detach();           // make sure we are rep's only user
+public:
+    Cow_vector(int s);
+    ~Cow_vector() { release(); }
+
+    Cow_vector(const Cow_vector& a);               // copy constructor: share a's elements
+    Cow_vector& operator=(const Cow_vector& a);    // copy assignment: share a's elements
+    Cow_vector(Cow_vector&& a);                    // move constructor
+    Cow_vector& operator=(Cow_vector&& a);         // move assignment
+
+    double& operator[](int i);                     // for writing: detaches
+    const double& operator[](int i) const;         // for reading: never detaches
+
+    int size() const { return rep->sz; }
+};
+
+Cow_vector::Cow_vector(int s)
+    :rep{new Rep{1,s,new double[s]}}
+{
+    for (int i=0; i!=s; ++i)
+        rep->elem[i] = 0;
+}
+
+// Copies can be made by different threads at the same time, so the use count is atomic.
+// Taking another use needs no ordering, but the last user must see all writes to the elements before deleting them.
+Cow_vector::Cow_vector(const Cow_vector& a)
+    :rep{a.rep}
+{
+    rep->uses.fetch_add(1,memory_order_relaxed);
+}
+
+void Cow_vector::release()
+{
+    if (rep && rep->uses.fetch_sub(1,memory_order_acq_rel)==1) {    // we were the last user
+        delete[] rep->elem;
+        delete rep;
+    }
+}
+
+Cow_vector& Cow_vector::operator=(const Cow_vector& a)
+{
+    a.rep->uses.fetch_add(1,memory_order_relaxed);   // first take the new use: a might be *this
+    release();
+    rep = a.rep;
+    return *this;
+}
+
+Cow_vector::Cow_vector(Cow_vector&& a)
+    :rep{a.rep}
+{
+    a.rep = nullptr;    // a can now only be destroyed or assigned to
+}
+
+Cow_vector& Cow_vector::operator=(Cow_vector&& a)
+{
+    if (this!=&a) {
+        release();
+        rep = a.rep;
+        a.rep = nullptr;
+    }
+    return *this;
+}
+
+// The copy is done by the first write, and only if someone else still uses the elements:
+void Cow_vector::detach()
+{
+    if (rep->uses.load(memory_order_acquire)==1)
+        return;                                     // we are the only user; write in place
+    Rep* p = new Rep{1,rep->sz,new double[rep->sz]};
+    for (int i=0; i!=rep->sz; ++i)
+        p->elem[i] = rep->elem[i];
+    release();
+    rep = p;
+}
+
+double& Cow_vector::operator[](int i)
+{
+    if (i<0 || size()<=i)
+        throw out_of_range{"Cow_vector::operator[]"};
+    detach();
+    return rep->elem[i];
+}
+
+const double& Cow_vector::operator[](int i) const
+{
+    if (i<0 || size()<=i)
+        throw out_of_range{"Cow_vector::operator[]"};
+    return rep->elem[i];
+}
+
+// Note that non-const subscripting detaches even if we only read, so read through a const reference.
+// Also, don't hold on to a reference obtained by writing: after a copy is made, a write through it would show in the copy.
+// Like a shared_ptr, a Cow_vector protects its use count, not its elements:
+// different threads may use different Cow_vectors sharing elements, but not the same Cow_vector without a lock.
+
+// A pipeline stage gets a copy and usually just reads it:
+double stage(Cow_vector v)      // O(1) copy
+{
+    const Cow_vector& cv = v;
+    double sum = 0;
+    for (int i=0; i!=cv.size(); ++i)
+        sum += cv[i];           // no detach
+    return sum;
+}
+
+// To see the effect under multi-threaded read load, let many threads copy and read the same data
+// and compare with a container that copies its elements:
+template<typename V>
+void time_stages(const char* name, const V& v, int nthreads, int copies)
+{
+    auto t0 = high_resolution_clock::now();
+    vector<thread> threads;
+    vector<double> sums(nthreads);     // keep the reads from being optimized away
+    for (int t=0; t!=nthreads; ++t)
+        threads.emplace_back([&,t] {
+            for (int i=0; i!=copies; ++i) {
+                V c = v;              // the copy each stage makes
+                const V& cc = c;
+                sums[t] += cc[i%cc.size()];
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+    auto t1 = high_resolution_clock::now();
+    cout << name << ", " << nthreads << " threads: " << duration_cast<milliseconds>(t1-t0).count() << "msec\n";
+}
+
+void copy_benchmark()
+{
+    const int n = 1'000'000;
+    Cow_vector cv(n);
+    vector<double> v(n);
+    for (int nthreads : {1,4,16,64}) {
+        time_stages("vector<double>",v,nthreads,100);
+        time_stages("Cow_vector",cv,nthreads,100);
+    }
+}
+// All threads update the same use count, so its cache line bounces between cores;
+// that is still far cheaper than copying a million doubles, but it is not free.
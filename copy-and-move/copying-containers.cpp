@@ -17,6 +17,7 @@ class Vector {
 private:
     double* elem; // elem points to an array of sz doubles
     int sz;
+    int cap;      // number of doubles allocated for elem; sz<=cap
 public:
     Vector(int s);                         // constructor: establish invariant, acquire resources
     ~Vector() { delete[] elem; }           // destructor: release resources
@@ -30,26 +31,71 @@ public:
     int size() const;
 };
 
+// Every constructor must now establish sz<=cap, not just the copy operations.
+// The move operations (@move, moveing-containers.cpp) must likewise carry cap along with elem and sz, and zero it in the moved-from Vector.
+Vector::Vector(int s)
+    :elem{new double[s]}, sz{s}, cap{s}
+{
+    for (int i=0; i!=s; ++i)
+        elem[i] = 0;
+}
+
 // A suitable definition of a copy constructor for Vector allocates the space for the required number of elements and 
 // then copies the elements into it so that after a copy each Vector has its own copy of the elements:
 Vector::Vector(const Vector& a) // copy constructor
     :elem{new double[a.sz]}, // allocate space for elements
-    sz{a.sz}
+    sz{a.sz},
+    cap{a.sz}
 {
     for (int i=0; i!=sz; ++i) // copy elements
         elem[i] = a.elem[i];
 }
 
-// we need a copy assignment in addition to the copy constructor:
+// we need a copy assignment in addition to the copy constructor.
+// If the elements fit into the space we already have, we simply overwrite our elements.
+// In a loop assigning Vectors of the same size, that saves an allocation and a deallocation per assignment.
 Vector& Vector::operator=(const Vector& a)     // copy assignment
 {
+     if (a.sz<=cap) {                          // reuse our space
+           for (int i=0; i!=a.sz; ++i)
+                 elem[i] = a.elem[i];
+           sz = a.sz;
+           return *this;
+     }
      double* p = new double[a.sz];
      for (int i=0; i!=a.sz; ++i)
            p[i] = a.elem[i];
      delete[] elem;         // delete old elements
      elem = p;
      sz = a.sz;
+     cap = a.sz;
      // The name this is predefined in a member function and points to the object for which the member function is called.
      return *this;
 }
 
+// Either way, an assignment that fails leaves the target unchanged (the strong guarantee):
+// new may throw, but only before we change anything, and copying a double can't throw.
+// For a Vector<T> where copying a T can throw, overwriting in place could leave a half-assigned Vector,
+// so the choice must depend on T:
+//
+//      if constexpr (is_nothrow_copy_assignable_v<T>)
+//           // overwrite in place, as above
+//      else
+//           // copy into new space, then release the old, as in the second half of operator=()
+//
+// To see what reusing saves, time repeated same-size assignment against making a new copy each time:
+void assignment_benchmark(int n, int count)
+{
+     Vector a(n);
+     Vector v(n);
+     auto t0 = high_resolution_clock::now();
+     for (int i=0; i!=count; ++i)
+           v = a;                               // reuses v's space
+     auto t1 = high_resolution_clock::now();
+     for (int i=0; i!=count; ++i) {
+           Vector tmp = a;                      // allocates and deallocates each time
+     }
+     auto t2 = high_resolution_clock::now();
+     cout << "n==" << n << ": assign " << duration_cast<nanoseconds>(t1-t0).count()/count << "ns, "
+          << "copy " << duration_cast<nanoseconds>(t2-t1).count()/count << "ns\n";
+}
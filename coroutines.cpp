@@ -0,0 +1,356 @@
+// @concurrency @coroutines @task @co_await @thread-pool
+
+// A handler that spends most of its time waiting – for a reply, a timer, the next message – doesn't need a thread of its own.
+// Written with threads (@task-and-threads), ten thousand concurrent requests need ten thousand threads, most of them blocked.
+// A coroutine is a function that can suspend itself at a co_await and be resumed later, possibly on another thread;
+// while it is suspended, its state is kept in a heap-allocated frame and no thread is tied up.
+// Here, every suspended coroutine is resumed by posting it to a Thread_pool (@thread-pool), the shared executor,
+// so a few threads run all the handlers.
+
+/**************************
+ * @task
+ **************************/
+
+// A task<T> is a coroutine that returns a T.
+// It is lazy: it doesn't start until someone co_awaits it, and when it finishes, it resumes its awaiter.
+template<typename T>
+class task;
+
+// The result of a task: a value or an exception
+template<typename T>
+struct Task_result {
+    optional<T> value;
+    exception_ptr ex;
+    void return_value(T v) { value.emplace(std::move(v)); }
+    T get()
+    {
+        if (ex)
+            rethrow_exception(ex);
+        return std::move(*value);
+    }
+};
+
+template<>
+struct Task_result<void> {
+    exception_ptr ex;
+    void return_void() {}
+    void get()
+    {
+        if (ex)
+            rethrow_exception(ex);
+    }
+};
+
+template<typename T>
+class task {
+public:
+    struct promise_type : Task_result<T> {
+        coroutine_handle<> awaiter;              // whom to resume when we are done
+
+        task get_return_object() { return task{coroutine_handle<promise_type>::from_promise(*this)}; }
+        suspend_always initial_suspend() noexcept { return {}; }   // lazy
+        auto final_suspend() noexcept
+        {
+            // Resume the awaiter directly (“symmetric transfer”) rather than by calling it, so that long chains don't overflow the stack
+            struct Final {
+                bool await_ready() noexcept { return false; }
+                coroutine_handle<> await_suspend(coroutine_handle<promise_type> h) noexcept
+                {
+                    auto a = h.promise().awaiter;
+                    return a ? a : noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            return Final{};
+        }
+        void unhandled_exception() { this->ex = current_exception(); }
+    };
+
+    task(task&& t) :h{exchange(t.h,nullptr)} {}
+    task& operator=(task&&) = delete;
+    ~task() { if (h) h.destroy(); }
+
+    // co_await t starts t and suspends us until t has finished
+    auto operator co_await() &&
+    {
+        struct Awaiter {
+            coroutine_handle<promise_type> h;
+            bool await_ready() { return false; }
+            coroutine_handle<> await_suspend(coroutine_handle<> a)
+            {
+                h.promise().awaiter = a;
+                return h;                        // run t now, on this thread
+            }
+            T await_resume() { return h.promise().get(); }
+        };
+        return Awaiter{h};
+    }
+private:
+    explicit task(coroutine_handle<promise_type> hh) :h{hh} {}
+    coroutine_handle<promise_type> h;
+};
+
+// A detached coroutine runs by itself and frees its frame when it finishes; nobody awaits it
+struct detached {
+    struct promise_type {
+        detached get_return_object() { return {}; }
+        suspend_never initial_suspend() noexcept { return {}; }
+        suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { terminate(); }
+    };
+};
+
+// co_await resume_on(pool) continues the coroutine on one of pool's threads
+auto resume_on(Thread_pool& pool)
+{
+    struct Awaiter {
+        Thread_pool& pool;
+        bool await_ready() { return false; }
+        void await_suspend(coroutine_handle<> h) { pool.post([h] { h.resume(); }); }
+        void await_resume() {}
+    };
+    return Awaiter{pool};
+}
+
+// spawn() starts a task on the pool and gives a Future (@promise) for its result,
+// so that ordinary code can get() it, or attach a continuation with then()
+template<typename T>
+Future<T> spawn(task<T> t, Thread_pool& pool = default_pool())
+{
+    Promise<T> p;
+    Future<T> f = p.get_future(&pool);
+    [](task<T> t, Promise<T> p, Thread_pool& pool) -> detached {
+        co_await resume_on(pool);
+        try {
+            if constexpr (is_void_v<T>) {
+                co_await std::move(t);
+                p.set_value({});
+            }
+            else
+                p.set_value(co_await std::move(t));
+        }
+        catch (...) {
+            p.set_exception(current_exception());
+        }
+    }(std::move(t),std::move(p),pool);
+    return f;
+}
+
+/**************************
+ * @awaitables
+ **************************/
+
+// co_await on a Future suspends the coroutine until the result is there, without blocking a thread:
+// the coroutine is resumed as a continuation (@continuations) on the shared pool.
+// Awaiting consumes the Future, as get() does: co_await std::move(f).
+template<typename T>
+auto operator co_await(Future<T>&& f)
+{
+    struct Awaiter {
+        Future<T> f;
+        bool await_ready() { return f.is_ready(); }
+        void await_suspend(coroutine_handle<> h) { f.on_ready([h] { h.resume(); },default_pool()); }
+        T await_resume() { return f.get(); }    // ready: doesn't wait
+    };
+    return Awaiter{std::move(f)};
+}
+
+// A single timer thread keeps the sleeping coroutines ordered by wake-up time and posts each to the pool when it is due
+class Timer_service {
+public:
+    explicit Timer_service(Thread_pool& p = default_pool()) :pool{p}, t{[this] { run(); }} {}
+    ~Timer_service();
+
+    void resume_at(steady_clock::time_point when, coroutine_handle<> h);
+private:
+    struct Entry {
+        steady_clock::time_point when;
+        coroutine_handle<> h;
+        bool operator>(const Entry& e) const { return when>e.when; }
+    };
+    void run();
+
+    priority_queue<Entry,vector<Entry>,greater<>> entries;   // the earliest first
+    mutex m;
+    condition_variable cv;
+    bool done = false;
+    Thread_pool& pool;
+    thread t;                                    // last: started after the other members are initialized
+};
+
+Timer_service::~Timer_service()
+{
+    {
+        scoped_lock lck {m};
+        done = true;
+    }
+    cv.notify_one();
+    t.join();
+}
+
+void Timer_service::resume_at(steady_clock::time_point when, coroutine_handle<> h)
+{
+    {
+        scoped_lock lck {m};
+        entries.push({when,h});
+    }
+    cv.notify_one();                             // the new entry may be the earliest
+}
+
+void Timer_service::run()
+{
+    unique_lock lck {m};
+    while (!done) {
+        if (entries.empty()) {
+            cv.wait(lck);
+            continue;
+        }
+        auto when = entries.top().when;
+        if (steady_clock::now()<when) {
+            cv.wait_until(lck,when);             // woken early by an earlier entry, by done, or spuriously: look again
+            continue;
+        }
+        auto h = entries.top().h;
+        entries.pop();
+        pool.post([h] { h.resume(); });
+    }
+}
+
+Timer_service& timers()
+{
+    static Timer_service ts;
+    return ts;
+}
+
+// co_await sleep_for(d) resumes the coroutine on the pool after d
+auto sleep_for(steady_clock::duration d)
+{
+    struct Awaiter {
+        steady_clock::duration d;
+        bool await_ready() { return d<=steady_clock::duration::zero(); }
+        void await_suspend(coroutine_handle<> h) { timers().resume_at(steady_clock::now()+d,h); }
+        void await_resume() {}
+    };
+    return Awaiter{d};
+}
+
+// The queues in @waiting-for-events block the thread that pops from an empty queue.
+// An Async_queue suspends the coroutine instead; push() hands the element directly to the longest-waiting coroutine
+// and posts it to the pool:
+template<typename T>
+class Async_queue {
+public:
+    explicit Async_queue(Thread_pool& p = default_pool()) :pool{p} {}
+
+    void push(T x);
+    auto pop();                                  // co_await q.pop() gives the next element
+private:
+    struct Pop_awaiter {
+        Async_queue& q;
+        optional<T> value;
+        coroutine_handle<> h;
+
+        bool await_ready() { return false; }
+        bool await_suspend(coroutine_handle<> hh);
+        T await_resume() { return std::move(*value); }
+    };
+
+    mutex m;
+    deque<T> elements;
+    deque<Pop_awaiter*> waiters;                 // each lives in a suspended coroutine's frame
+    Thread_pool& pool;
+};
+
+template<typename T>
+void Async_queue<T>::push(T x)
+{
+    Pop_awaiter* w;
+    {
+        scoped_lock lck {m};
+        if (waiters.empty()) {
+            elements.push_back(std::move(x));
+            return;
+        }
+        w = waiters.front();
+        waiters.pop_front();
+        w->value.emplace(std::move(x));
+    }
+    pool.post([h = w->h] { h.resume(); });
+}
+
+template<typename T>
+auto Async_queue<T>::pop()
+{
+    return Pop_awaiter{*this,{},{}};
+}
+
+// Check for an element and register as a waiter under the same lock, so that a push() can't slip in between.
+// Once we are in waiters, a push() may resume us on another thread before we return, so we must not touch *this after unlocking.
+template<typename T>
+bool Async_queue<T>::Pop_awaiter::await_suspend(coroutine_handle<> hh)
+{
+    scoped_lock lck {q.m};
+    if (!q.elements.empty()) {
+        value.emplace(std::move(q.elements.front()));
+        q.elements.pop_front();
+        return false;                            // don't suspend after all
+    }
+    h = hh;
+    q.waiters.push_back(this);
+    return true;
+}
+
+/**************************
+ * @handlers
+ **************************/
+
+// A handler reads its requests from a queue, waits for a (simulated) backend, and has the computation done on the pool.
+// It reads like sequential code, but each co_await frees the thread for other handlers:
+struct Request {
+    int id;
+    vector<double> data;
+};
+
+task<double> serve(Request r)
+{
+    co_await sleep_for(milliseconds{10});       // e.g., a database lookup
+    auto f = default_pool().submit([&r] { return accumulate(r.data.begin(),r.data.end(),0.0); });
+    co_return co_await std::move(f);
+}
+
+task<int> handler(Async_queue<Request>& requests, int n)
+{
+    int served = 0;
+    for (int i = 0; i!=n; ++i) {
+        Request r = co_await requests.pop();
+        co_await serve(std::move(r));
+        ++served;
+    }
+    co_return served;
+}
+
+// Ten thousand concurrent handlers on a pool with a thread per core:
+void handler_demo()
+{
+    const int handlers = 10'000;
+    const int per_handler = 10;
+    Async_queue<Request> requests;
+
+    auto t0 = steady_clock::now();
+    vector<Future<int>> results;
+    for (int i = 0; i!=handlers; ++i)
+        results.push_back(spawn(handler(requests,per_handler)));
+    for (int i = 0; i!=handlers*per_handler; ++i)
+        requests.push({i,vector<double>(100,1.0)});
+
+    int served = 0;
+    for (auto& f : results)
+        served += f.get();
+    auto t1 = steady_clock::now();
+    cout << served << " requests by " << handlers << " handlers on " << default_pool().size() << " threads: "
+         << duration_cast<milliseconds>(t1-t0).count() << "msec\n";
+}
+
+// Note that serve() captures r by reference in the task it submits; that's fine only because it awaits that task before returning.
+// Also, a Future's get() blocks (or helps the pool); call it only outside of coroutines, as handler_demo() does.
@@ -9,6 +9,12 @@ double& Vector::operator[](int i)
     return elem[i];
 }
 
+// Alternatively, the macro can select a checking policy once, and
+// the containers take the policy as a template argument (see Vec and its policies in @vector):
+using Range_check = conditional_t<RANGE_CHECK,Throw_check,Unchecked>;
+
+Vec<double,Range_check> v(100);    // checked only if RANGE_CHECK
+
 void f(const char* p)
 {
     // The standard library offers the debug macro, assert(), to assert that a condition must hold at run time.
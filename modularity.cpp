@@ -8,15 +8,29 @@
 // the function definitions are "elsewhere."
 double sqrt(double); // the square root function takes a double and return a double
 
+// A declaration can also specify choices for the user, here how a Vector acquires memory for its elements:
+enum class Storage {
+    standard,         // new double[s]: aligned for double only
+    cache_aligned,    // aligned to a 64-byte cache line, e.g. for SIMD code
+    huge_pages        // cache aligned; large buffers also ask for transparent huge pages
+};
+
 class Vector {
 public:
-    Vector(int s);
+    Vector(int s, Storage st = Storage::standard);
+    ~Vector();
+
+    // A Vector owns its elements, so the default (memberwise) copy would delete them twice (see @copy)
+    Vector(const Vector&) = delete;
+    Vector& operator=(const Vector&) = delete;
+
     double& operator[](int i);
-    int size();
+    int size() const;
 
 private:
     double* elem; // elem points  to an array of sz doubles
     int sz;
+    Storage mode; // how elem was allocated
 };
 
 // sqrt() is a part of the standard library
@@ -27,10 +41,46 @@ private:
 // ...
 // }
 
-// For Vector, we need to define all three member functions
-Vector::Vector(int s)           // definition of the constructor
-    :elem{new double[s]}, sz{s} // initialize members
+// For Vector, we need to define all four member functions
+// and the helpers that pick the alignment and allocate the elements
+constexpr std::size_t cache_line = 64;
+constexpr std::size_t huge_page = 2*1024*1024;           // the usual x86-64 huge page size
+constexpr std::size_t huge_page_threshold = 16*huge_page; // smaller buffers don't suffer much from TLB misses
+
+// The helpers are not part of Vector’s interface, so an unnamed namespace keeps them out of other translation units
+namespace {
+
+std::size_t alignment(int s, Storage st)
+{
+    if (st==Storage::huge_pages && huge_page_threshold<=s*sizeof(double))
+        return huge_page;     // a huge page can only back a range aligned to a huge page
+    return cache_line;
+}
+
+double* allocate(int s, Storage st)
+{
+    if (st==Storage::standard)
+        return new double[s];
+    const auto a = alignment(s,st);
+    void* p = ::operator new(s*sizeof(double),std::align_val_t{a});
+    if (a==huge_page)
+        madvise(p,s*sizeof(double),MADV_HUGEPAGE);   // only a hint: ignored where transparent huge pages are disabled
+    return static_cast<double*>(p);
+}
+
+}
+
+Vector::Vector(int s, Storage st)        // definition of the constructor
+    :elem{allocate(s,st)}, sz{s}, mode{st} // initialize members
+{
+}
+
+Vector::~Vector()               // definition of the destructor: release memory the way it was acquired
 {
+    if (mode==Storage::standard)
+        delete[] elem;
+    else
+        ::operator delete(elem,std::align_val_t{alignment(sz,mode)});
 }
 
 double& Vector::operator[](int i) // definition of subscripting`
@@ -38,7 +88,7 @@ double& Vector::operator[](int i) // definition of subscripting`
     return elem[i];
 }
 
-int Vector::size() // definition of size()
+int Vector::size() const // definition of size()
 {
     return sz;
 }
@@ -8,25 +8,73 @@ module;
 // If you import something into a module, users of your module do not implicitly gain access to (and are not bothered by) what you imported: import is not transitive.
 
 // ... here we put stuff that Vector might need for its implementation ...
+#include <new>          // align_val_t
+#include <sys/mman.h>   // madvise()
 
 // This defines a module called Vector, which exports the class Vector, 
 // all its member functions, and 
 // the non-member function size().
 export module Vector; // defining the module called "Vector"
 
+// How a Vector acquires memory for its elements:
+export enum class Storage {
+     standard,         // new double[s]: aligned for double only
+     cache_aligned,    // aligned to a 64-byte cache line
+     huge_pages        // cache aligned; large buffers also ask for transparent huge pages
+};
+
 export class Vector {
 public:
-     Vector(int s);
+     Vector(int s, Storage st = Storage::standard);
+     ~Vector();
+
+     // A Vector owns its elements, so the default (memberwise) copy would delete them twice (see @copy)
+     Vector(const Vector&) = delete;
+     Vector& operator=(const Vector&) = delete;
+
      double& operator[](int i);
-     int size();
+     int size() const;
+     double* data() { return elem; }
 private:
      double* elem;     // elem points to an array of sz doubles
      int sz;
+     Storage mode;     // how elem was allocated
 };
 
-Vector::Vector(int s)
-     :elem{new double[s]}, sz{s}        // initialize members
+// Names that are not exported are usable only inside the module:
+constexpr std::size_t cache_line = 64;
+constexpr std::size_t huge_page = 2*1024*1024;             // the usual x86-64 huge page size
+constexpr std::size_t huge_page_threshold = 16*huge_page;   // smaller buffers don't suffer much from TLB misses
+
+std::size_t alignment(int s, Storage st)
+{
+     if (st==Storage::huge_pages && huge_page_threshold<=s*sizeof(double))
+           return huge_page;      // a huge page can only back a range aligned to a huge page
+     return cache_line;
+}
+
+double* allocate(int s, Storage st)
+{
+     if (st==Storage::standard)
+           return new double[s];
+     const auto a = alignment(s,st);
+     void* p = ::operator new(s*sizeof(double),std::align_val_t{a});
+     if (a==huge_page)
+           madvise(p,s*sizeof(double),MADV_HUGEPAGE);    // only a hint
+     return static_cast<double*>(p);
+}
+
+Vector::Vector(int s, Storage st)
+     :elem{allocate(s,st)}, sz{s}, mode{st}        // initialize members
+{
+}
+
+Vector::~Vector()
 {
+     if (mode==Storage::standard)
+           delete[] elem;
+     else
+           ::operator delete(elem,std::align_val_t{alignment(sz,mode)});
 }
 
 double& Vector::operator[](int i)
@@ -34,7 +82,7 @@ double& Vector::operator[](int i)
      return elem[i];
 }
 
-int Vector::size()
+int Vector::size() const
 {
      return sz;
 }
@@ -3,8 +3,9 @@ import Vector; // get Vector's interface
 // It's OK to import the standard library mathematical functions also,
 // The new way (use import) and the old way (use #include) can mix.
 #include <cmath> // get the standard-library math function interface including sqrt()
+#include "../separate-compilation/sqrt-sum.h" // get the vectorized kernel
 
-double sqrt_sum(Vector& v)
+double sqrt_sum_loop(Vector& v)
 {
      double sum = 0;
      for (int i=0; i!=v.size(); ++i)
@@ -12,3 +13,8 @@ double sqrt_sum(Vector& v)
      return sum;
 }
 
+// The same kernel serves both Vectors; it only needs the elements
+double sqrt_sum(Vector& v)
+{
+     return sqrt_sum(v.data(),v.size());
+}
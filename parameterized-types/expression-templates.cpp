@@ -0,0 +1,155 @@
+// @templates @parameterized-types @expression-templates @numeric
+
+// With the obvious definitions of arithmetic operators for Vector<T>,
+// an expression such as a = b*3.14+c/b allocates a temporary Vector for each operator and
+// traverses the elements once per operator.
+// Instead, we can let the operators build a description of the computation – an expression template –
+// and evaluate it only when it is assigned to a Vector: one loop, no temporaries.
+// That is what valarray may do; here we make sure it happens.
+
+// The leaves of an expression are Vectors and scalars.
+// A Vector is represented by a pointer to its elements, so that evaluation doesn't go through the range-checked operator[]:
+template<typename T>
+struct Vector_ref {
+    const T* elem;
+    int sz;
+    T operator[](int i) const { return elem[i]; }
+    int size() const { return sz; }
+};
+
+template<typename T>
+struct Scalar {
+    T val;
+    T operator[](int) const { return val; }   // the same value for every element
+};
+
+// An interior node applies an operation to the corresponding elements of its operands.
+// Operands are held by value; they are small (a pointer and a size, a scalar, or other nodes).
+template<typename Op, typename L, typename R>
+struct Vector_op {
+    Op op;
+    L left;
+    R right;
+    int sz;
+    auto operator[](int i) const { return op(left[i],right[i]); }
+    int size() const { return sz; }
+};
+
+template<typename E>
+struct is_vector_expression : false_type {};
+
+template<typename T>
+struct is_vector_expression<Vector_ref<T>> : true_type {};
+
+template<typename Op, typename L, typename R>
+struct is_vector_expression<Vector_op<Op,L,R>> : true_type {};
+
+template<typename E>
+concept Vector_expression = is_vector_expression<E>::value;
+
+template<typename X>
+struct is_Vector : false_type {};
+
+template<typename T>
+struct is_Vector<Vector<T>> : true_type {};
+
+template<typename X>
+concept Vector_operand = Vector_expression<X> || is_Vector<X>::value;
+
+// leaf() turns an operand into a node.
+// An expression is returned by value, so that a node holds a copy of its sub-expressions rather than
+// a reference to a temporary that is destroyed at the end of the full-expression that created it.
+template<typename T>
+Vector_ref<T> leaf(const Vector<T>& v) { return {v.data(),v.size()}; }
+
+template<Vector_expression E>
+E leaf(const E& e) { return e; }
+
+template<typename T>
+    requires is_arithmetic_v<T>
+Scalar<T> leaf(T x) { return {x}; }
+
+template<typename X>
+int size_of(const X& x)
+{
+    if constexpr (is_arithmetic_v<X>)
+        return -1;              // a scalar fits any size
+    else
+        return x.size();
+}
+
+template<typename Op, typename L, typename R>
+auto make_op(Op op, const L& l, const R& r)
+{
+    const int ls = size_of(l);
+    const int rs = size_of(r);
+    if (0<=ls && 0<=rs && ls!=rs)
+        throw length_error{"Vector expression: operands of different sizes"};
+    return Vector_op<Op,decltype(leaf(l)),decltype(leaf(r))>{op,leaf(l),leaf(r),max(ls,rs)};
+}
+
+// At least one operand must be a Vector or an expression; otherwise, we would hijack 3.14*2
+template<typename L, typename R>
+    requires Vector_operand<L> || Vector_operand<R>
+auto operator+(const L& l, const R& r) { return make_op(plus<>{},l,r); }
+
+template<typename L, typename R>
+    requires Vector_operand<L> || Vector_operand<R>
+auto operator-(const L& l, const R& r) { return make_op(minus<>{},l,r); }
+
+template<typename L, typename R>
+    requires Vector_operand<L> || Vector_operand<R>
+auto operator*(const L& l, const R& r) { return make_op(multiplies<>{},l,r); }
+
+template<typename L, typename R>
+    requires Vector_operand<L> || Vector_operand<R>
+auto operator/(const L& l, const R& r) { return make_op(divides<>{},l,r); }
+
+// Vector<T> needs a few more members: access to its elements and construction and assignment from an expression
+template<typename T>
+class Vector {
+    // ...
+public:
+    const T* data() const { return elem; }
+
+    template<Vector_expression E>
+    Vector(const E& e);                 // evaluate e into a new Vector
+
+    template<Vector_expression E>
+    Vector& operator=(const E& e);      // evaluate e into this Vector
+};
+
+// The whole expression is evaluated in this one loop.
+// Each element of the result depends only on the corresponding elements of the operands,
+// so it is safe even if the target is also an operand (a = a*2) and
+// we can tell the compiler to vectorize it (e.g., compile with -fopenmp-simd):
+template<typename T>
+template<Vector_expression E>
+Vector<T>& Vector<T>::operator=(const E& e)
+{
+    if (e.size()!=sz)
+        throw length_error{"Vector::operator=(expression)"};
+    #pragma omp simd
+    for (int i=0; i<sz; ++i)
+        elem[i] = e[i];
+    return *this;
+}
+
+template<typename T>
+template<Vector_expression E>
+Vector<T>::Vector(const E& e)
+    :Vector(e.size())
+{
+    *this = e;
+}
+
+// The numeric code looks the same as with valarray:
+void f(Vector<double>& a, const Vector<double>& b, const Vector<double>& c)
+{
+    a = b*3.14+c/b;                        // one loop, no temporary Vectors
+    Vector<double> d = (a-b)*(a+b);        // one loop, one allocation (for d itself)
+    // ...
+}
+
+// Note that an expression refers to its Vectors (but not to its sub-expressions),
+// so don't keep one (e.g., in an auto variable) longer than the Vectors it uses.
@@ -17,9 +17,11 @@ class Vector {
 private:
     T* elem; // elem points to an array of sz elements of value T
     int sz;
+    pmr::memory_resource* res; // where elem was allocated
 public:
-    explicit Vector(int s); // constructor: establish invariant, acquire resources
-    ~Vector() { delete[] elem; } // destructor: release resources
+    // By default, the elements are allocated using new and delete (see @allocator)
+    explicit Vector(int s, pmr::memory_resource* r = pmr::get_default_resource()); // constructor: establish invariant, acquire resources
+    ~Vector(); // destructor: release resources
 
     // ... copy and move operations
 
@@ -30,14 +32,29 @@ public:
 
 // The member functions
 template<typename T>
-Vector<T>::Vector(int s)
+Vector<T>::Vector(int s, pmr::memory_resource* r)
+    :res{r}
 {
     if (s<0)
         throw Negative_size{};
-    elem = new T[s];
+    elem = static_cast<T*>(res->allocate(s*sizeof(T),alignof(T)));
+    try {
+        uninitialized_default_construct_n(elem,s);   // as new T[s] does
+    }
+    catch (...) {
+        res->deallocate(elem,s*sizeof(T),alignof(T));
+        throw;
+    }
     sz = s;
 }
 
+template<typename T>
+Vector<T>::~Vector()
+{
+    destroy_n(elem,sz);
+    res->deallocate(elem,sz*sizeof(T),alignof(T));
+}
+
 template<typename T>
 const T& Vector<T>::operator[](int i) const
 {
@@ -77,3 +94,57 @@ void f2(Vector<string>& vs) // Vector of some string
     for (auto& s : vs)
         cout << s << '\n';
 }
+
+/************
+ * @arena
+ ************/
+
+// A request handler typically builds many short-lived Vectors and frees them all at the end of the request.
+// Allocating each from the general free store is wasteful: 
+// a monotonic_buffer_resource hands out memory by bumping a pointer, ignores individual deallocations, and
+// releases everything at once when it is destroyed.
+void handle_request(const string& request)
+{
+    array<byte,64*1024> buf;                                   // most requests fit on the stack
+    pmr::monotonic_buffer_resource arena {buf.data(),buf.size()};   // larger ones continue on the free store
+
+    Vector<int> offsets(64,&arena);
+    Vector<double> values(256,&arena);
+    Vector<char> scratch(4096,&arena);
+    // ... parse request into offsets, values, and scratch ...
+}   // destructors run for the Vectors, then the arena releases all their memory in one go
+
+// A monotonic_buffer_resource is not thread-safe, but that doesn't matter: each request (thread) has its own.
+// To see the difference under load, run many handlers on many threads with and without an arena:
+template<typename Handler>
+void time_handlers(const char* name, Handler h, int nthreads, int requests)
+{
+    auto t0 = high_resolution_clock::now();
+    vector<thread> threads;
+    for (int t = 0; t!=nthreads; ++t)
+        threads.emplace_back([=] {
+            for (int i = 0; i!=requests; ++i)
+                h();
+        });
+    for (auto& t : threads)
+        t.join();
+    auto t1 = high_resolution_clock::now();
+    double secs = duration_cast<microseconds>(t1-t0).count()/1e6;
+    cout << name << ": " << nthreads*requests/secs << " requests/s\n";
+}
+
+void arena_benchmark()
+{
+    auto work = [](pmr::memory_resource* r) {
+        for (int i = 0; i!=32; ++i) {            // dozens of short-lived Vectors per request
+            Vector<double> v(100+i,r);
+            v[0] = i;
+        }
+    };
+    time_handlers("free store",[&] { work(pmr::get_default_resource()); },32,100'000);
+    time_handlers("arena",[&] {
+        array<byte,64*1024> buf;
+        pmr::monotonic_buffer_resource arena {buf.data(),buf.size()};
+        work(&arena);
+    },32,100'000);
+}
@@ -0,0 +1,236 @@
+// @templates @parameterized-types @small-buffer-optimization
+
+// Most Vectors hold only a few elements, yet each Vector<T> allocates its elements on the free store.
+// A value template argument lets us keep up to N elements inside the object itself and
+// only go to the free store when a Small_vector grows beyond that.
+// This is the technique that string implementations use for short strings (the short string optimization).
+template<typename T, int N>
+class Small_vector {
+    static_assert(0<N,"a Small_vector needs room for at least one element");
+private:
+    T* elem;     // points to buf or to elements on the free store
+    int sz;
+    int cap;
+    alignas(T) unsigned char buf[N*sizeof(T)];    // room for N elements; no T is constructed here until needed
+
+    bool is_small() const { return elem==reinterpret_cast<const T*>(buf); }
+    void grow(int newcap);
+    template<typename Arg>
+    void grow_and_push(Arg&& x);   // grow, and add x at the end
+    void steal(Small_vector& a);   // move a's elements into an empty *this
+    void clear();                  // destroy all elements and return to the inline buffer
+public:
+    Small_vector() :elem{reinterpret_cast<T*>(buf)}, sz{0}, cap{N} {}
+    explicit Small_vector(int s);
+    ~Small_vector();
+
+    Small_vector(const Small_vector& a);
+    Small_vector& operator=(const Small_vector& a);
+    Small_vector(Small_vector&& a);
+    Small_vector& operator=(Small_vector&& a);
+
+    // the same subscripting interface as Vector<T>
+    T& operator[](int i);
+    const T& operator[](int i) const;
+    int size() const { return sz; }
+    int capacity() const { return cap; }
+
+    void push_back(const T& t);
+    void push_back(T&& t);
+
+    T* begin() { return elem; }
+    T* end() { return elem+sz; }
+    const T* begin() const { return elem; }
+    const T* end() const { return elem+sz; }
+};
+
+template<typename T, int N>
+Small_vector<T,N>::Small_vector(int s)
+    :Small_vector{}
+{
+    if (s<0)
+        throw Negative_size{};
+    if (N<s)
+        grow(s);
+    uninitialized_value_construct(elem,elem+s);
+    sz = s;
+}
+
+template<typename T, int N>
+Small_vector<T,N>::~Small_vector()
+{
+    clear();      // only spilled elements were allocated, so only they are deleted
+}
+
+// Moving elements between the inline buffer and the free store is the only subtle part:
+template<typename T, int N>
+void Small_vector<T,N>::grow(int newcap)
+{
+    T* p = static_cast<T*>(::operator new(newcap*sizeof(T)));
+    try {
+        uninitialized_move(elem,elem+sz,p);     // if a move throws, the elements moved so far are destroyed
+    }
+    catch (...) {
+        ::operator delete(p);
+        throw;
+    }
+    destroy(elem,elem+sz);
+    if (!is_small())
+        ::operator delete(elem);
+    elem = p;
+    cap = newcap;
+}
+
+// In v.push_back(v[i]), the argument refers to one of our elements,
+// so the new element must be constructed before the old ones are moved away:
+template<typename T, int N>
+template<typename Arg>
+void Small_vector<T,N>::grow_and_push(Arg&& x)
+{
+    const int newcap = 2*cap;
+    T* p = static_cast<T*>(::operator new(newcap*sizeof(T)));
+    try {
+        new(p+sz) T{std::forward<Arg>(x)};
+    }
+    catch (...) {
+        ::operator delete(p);
+        throw;
+    }
+    try {
+        uninitialized_move(elem,elem+sz,p);
+    }
+    catch (...) {
+        destroy_at(p+sz);
+        ::operator delete(p);
+        throw;
+    }
+    destroy(elem,elem+sz);
+    if (!is_small())
+        ::operator delete(elem);
+    elem = p;
+    cap = newcap;
+    ++sz;
+}
+
+template<typename T, int N>
+Small_vector<T,N>::Small_vector(const Small_vector& a)
+    :Small_vector{}
+{
+    if (N<a.sz)
+        grow(a.sz);
+    uninitialized_copy(a.begin(),a.end(),elem);
+    sz = a.sz;
+}
+
+template<typename T, int N>
+Small_vector<T,N>& Small_vector<T,N>::operator=(const Small_vector& a)
+{
+    Small_vector tmp {a};         // copy, then move: no change if the copy throws
+    return *this = std::move(tmp);
+}
+
+// Unlike Vector<T>, a Small_vector can't just "grab the elements" if they are inline;
+// they have to be moved one by one.
+template<typename T, int N>
+void Small_vector<T,N>::steal(Small_vector& a)
+{
+    if (a.is_small()) {
+        uninitialized_move(a.begin(),a.end(),elem);
+        sz = a.sz;
+        a.clear();
+    }
+    else {
+        elem = a.elem;      // grab the free-store elements
+        sz = a.sz;
+        cap = a.cap;
+        a.elem = reinterpret_cast<T*>(a.buf);
+        a.sz = 0;
+        a.cap = N;
+    }
+}
+
+template<typename T, int N>
+void Small_vector<T,N>::clear()
+{
+    destroy(elem,elem+sz);
+    if (!is_small())
+        ::operator delete(elem);
+    elem = reinterpret_cast<T*>(buf);
+    sz = 0;
+    cap = N;
+}
+
+template<typename T, int N>
+Small_vector<T,N>::Small_vector(Small_vector&& a)
+    :Small_vector{}
+{
+    steal(a);
+}
+
+template<typename T, int N>
+Small_vector<T,N>& Small_vector<T,N>::operator=(Small_vector&& a)
+{
+    if (this!=&a) {
+        clear();
+        steal(a);
+    }
+    return *this;
+}
+
+template<typename T, int N>
+T& Small_vector<T,N>::operator[](int i)
+{
+    if (i<0 || size()<=i)
+        throw out_of_range{"Small_vector::operator[]"};
+    return elem[i];
+}
+
+template<typename T, int N>
+const T& Small_vector<T,N>::operator[](int i) const
+{
+    if (i<0 || size()<=i)
+        throw out_of_range{"Small_vector::operator[]"};
+    return elem[i];
+}
+
+template<typename T, int N>
+void Small_vector<T,N>::push_back(const T& t)
+{
+    if (sz==cap) {
+        grow_and_push(t);        // spill to the free store (or grow there)
+        return;
+    }
+    new(elem+sz) T{t};
+    ++sz;
+}
+
+template<typename T, int N>
+void Small_vector<T,N>::push_back(T&& t)
+{
+    if (sz==cap) {
+        grow_and_push(std::move(t));
+        return;
+    }
+    new(elem+sz) T{std::move(t)};
+    ++sz;
+}
+
+// Small_vector can be used wherever we used Vector<T> for short sequences.
+// Parsing a request into its (usually few) fields no longer needs the free store:
+Small_vector<string,16> split_fields(const string& line)
+{
+    Small_vector<string,16> fields;
+    istringstream is {line};
+    for (string s; is>>s;)
+        fields.push_back(std::move(s));
+    return fields;
+}
+
+void f3(const string& request)
+{
+    for (auto& s : split_fields(request))     // range-for works as for Vector
+        cout << s << '\n';
+}
+
+// The price is a bigger object: sizeof(Small_vector<string,16>) is more than 16*sizeof(string),
+// so don't use a large N for objects that are themselves stored in large numbers.
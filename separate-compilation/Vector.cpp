@@ -1,17 +1,54 @@
 #include "Vector.h" // get Vector's interface
+#include <new>          // align_val_t
+#include <sys/mman.h>   // madvise()
 
-Vector::Vector(int s)           // definition of the constructor
-    :elem{new double[s]}, sz{s} // initialize members
+constexpr std::size_t cache_line = 64;
+constexpr std::size_t huge_page = 2*1024*1024;           // the usual x86-64 huge page size
+constexpr std::size_t huge_page_threshold = 16*huge_page; // smaller buffers don't suffer much from TLB misses
+
+// Only the members use these helpers, so they get internal linkage and cannot clash with names in other .cpp files
+namespace {
+
+// A huge page can only back a range aligned to a huge page, so large huge_pages buffers get that alignment
+std::size_t alignment(int s, Storage st)
+{
+    if (st==Storage::huge_pages && huge_page_threshold<=s*sizeof(double))
+        return huge_page;
+    return cache_line;
+}
+
+double* allocate(int s, Storage st)
+{
+    if (st==Storage::standard)
+        return new double[s];
+    const auto a = alignment(s,st);
+    void* p = ::operator new(s*sizeof(double),std::align_val_t{a});
+    if (a==huge_page)
+        madvise(p,s*sizeof(double),MADV_HUGEPAGE);   // only a hint: ignored where transparent huge pages are disabled
+    return static_cast<double*>(p);
+}
+
+}
+
+Vector::Vector(int s, Storage st) // definition of the constructor
+    :elem{allocate(s,st)}, sz{s}, mode{st} // initialize members
 {
 }
 
+Vector::~Vector() // memory must be released the way it was acquired
+{
+    if (mode==Storage::standard)
+        delete[] elem;
+    else
+        ::operator delete(elem,std::align_val_t{alignment(sz,mode)});
+}
+
 double& Vector::operator[](int i) // definition of subscripting`
 {
     return elem[i];
 }
 
-int Vector::size() // definition of size()
+int Vector::size() const // definition of size()
 {
     return sz;
 }
-
@@ -3,17 +3,34 @@
 // represent that modularity logically through language features, 
 // and then exploit the modularity physically through files for effective separate compilation.
 
+// How a Vector acquires memory for its elements.
+// SIMD code wants its data aligned to a cache line, and for multi-GB arrays,
+// huge pages cut the number of TLB misses.
+enum class Storage {
+    standard,         // new double[s]: aligned for double only
+    cache_aligned,    // aligned to a 64-byte cache line
+    huge_pages        // cache aligned; large buffers also ask for transparent huge pages
+};
+
 // This declaration would be placed in a file Vector.h. 
 // Users then include that file, called a header file, to access that interface.
 class Vector {
 public:
-    Vector(int s);
+    Vector(int s, Storage st = Storage::standard);
+    ~Vector();
+
+    // A Vector owns its elements, so the default (memberwise) copy would delete them twice (see @copy)
+    Vector(const Vector&) = delete;
+    Vector& operator=(const Vector&) = delete;
+
     double& operator[](int i);
-    int size();
+    int size() const;
+    double* data() { return elem; }   // defined here, so that it can be inlined
 
 private:
     double* elem; // elem points to an array of sz doubles
     int sz;
+    Storage mode; // how elem was allocated
 };
 
 // The code in user.cpp and Vector.cpp shares the Vector interface information presented in Vector.h, 
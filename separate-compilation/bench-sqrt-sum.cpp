@@ -0,0 +1,51 @@
+// @compilation @modularity @simd @benchmark
+// How much does separate compilation cost us, and how much does the vectorized kernel buy?
+// Separate-TU build:
+//     g++ -std=c++20 -O2 Vector.cpp sqrt-sum.cpp user.cpp bench-sqrt-sum.cpp
+// Module build (the Vector module from ../modules instead of Vector.h):
+//     g++ -std=c++20 -fmodules-ts -O2 ../modules/Vector.cpp ../modules/user.cpp sqrt-sum.cpp bench-sqrt-sum.cpp -DVECTOR_MODULE
+#ifdef VECTOR_MODULE
+import Vector;
+#else
+#include "Vector.h"
+#endif
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+using namespace std::chrono;
+
+double sqrt_sum_loop(Vector& v);   // from user.cpp: one call of operator[] per element
+double sqrt_sum(Vector& v);        // from user.cpp: the vectorized kernel
+
+// What we would get from a Vector defined entirely in a header:
+// the compiler sees the elements and can inline (and, given -fno-math-errno, vectorize) the loop itself
+double sqrt_sum_inline(Vector& v)
+{
+    const double* p = v.data();
+    double sum = 0;
+    for (int i=0; i!=v.size(); ++i)
+        sum+=std::sqrt(p[i]);
+    return sum;
+}
+
+template<typename F>
+void time_sum(const char* name, F f, Vector& v)
+{
+    double sum = f(v);    // warm up caches and the kernel selection
+    auto t0 = high_resolution_clock::now();
+    for (int i=0; i!=10; ++i)
+        sum += f(v);
+    auto t1 = high_resolution_clock::now();
+    std::cout << name << ": " << duration_cast<microseconds>(t1-t0).count()/10 << "us (" << sum << ")\n";
+}
+
+int main()
+{
+    Vector v(10'000'000,Storage::cache_aligned);
+    for (int i=0; i!=v.size(); ++i)
+        v[i] = i;
+    time_sum("out-of-line operator[]",sqrt_sum_loop,v);
+    time_sum("header-inline loop",sqrt_sum_inline,v);
+    time_sum("vectorized kernel",[](Vector& v) { return sqrt_sum(v); },v);
+}
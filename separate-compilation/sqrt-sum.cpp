@@ -0,0 +1,61 @@
+#include "sqrt-sum.h"   // get the kernel's interface
+#include <cmath>
+#include <immintrin.h>  // SIMD intrinsics
+
+// A loop calling an out-of-line operator[] can't be vectorized: the compiler can't see what operator[] does.
+// Here we work directly on the elements, a whole vector register at a time, and
+// pick the widest instructions the machine we run on supports.
+// Note that adding in a different order can give a slightly different rounding of the result.
+
+// Only sqrt_sum() is exported; the kernels and the selector are internal to this file
+namespace {
+
+double sqrt_sum_scalar(const double* p, int n)
+{
+    double sum = 0;
+    for (int i=0; i!=n; ++i)
+        sum += std::sqrt(p[i]);
+    return sum;
+}
+
+__attribute__((target("avx2")))
+double sqrt_sum_avx2(const double* p, int n)
+{
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+    for (; i+4<=n; i+=4)
+        acc = _mm256_add_pd(acc,_mm256_sqrt_pd(_mm256_loadu_pd(p+i)));   // 4 square roots at a time
+    double lanes[4];
+    _mm256_storeu_pd(lanes,acc);
+    return lanes[0]+lanes[1]+lanes[2]+lanes[3]+sqrt_sum_scalar(p+i,n-i);   // the leftover elements
+}
+
+__attribute__((target("avx512f")))
+double sqrt_sum_avx512(const double* p, int n)
+{
+    __m512d acc = _mm512_setzero_pd();
+    int i = 0;
+    for (; i+8<=n; i+=8)
+        acc = _mm512_add_pd(acc,_mm512_sqrt_pd(_mm512_loadu_pd(p+i)));   // 8 square roots at a time
+    return _mm512_reduce_add_pd(acc)+sqrt_sum_scalar(p+i,n-i);
+}
+
+using Kernel = double(const double*,int);
+
+// Ask the CPU once; every later call goes straight to the chosen kernel
+Kernel* select_sqrt_sum()
+{
+    if (__builtin_cpu_supports("avx512f"))
+        return sqrt_sum_avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return sqrt_sum_avx2;
+    return sqrt_sum_scalar;
+}
+
+}
+
+double sqrt_sum(const double* first, int n)
+{
+    static Kernel* const kernel = select_sqrt_sum();   // initialized once, thread-safely
+    return kernel(first,n);
+}
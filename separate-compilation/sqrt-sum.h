@@ -0,0 +1,4 @@
+// @compilation @modularity @simd
+// The interface to the vectorized kernel: it takes a plain range of doubles,
+// so that it can be used with any Vector, whether from Vector.h or from the Vector module.
+double sqrt_sum(const double* first, int n);   // sum of square roots of [first:first+n)
@@ -1,10 +1,18 @@
-#include "Vector.h" // get Vector's interface
-#include <cmath>    // get the standard-library math interface include sqrt()
+#include "Vector.h"   // get Vector's interface
+#include "sqrt-sum.h" // get the vectorized kernel
+#include <cmath>      // get the standard-library math interface include sqrt()
 
-double sqrt_sum(Vector& v)
+// Each v[i] is a call of the operator[] defined in Vector.cpp, so this loop can't be inlined or vectorized:
+double sqrt_sum_loop(Vector& v)
 {
     double sum = 0;
     for (int i=0; i!=v.size(); ++i)
         sum+=std::sqrt(v[i]); // sum of square roots
     return sum;
 }
+
+// Passing the elements to the kernel avoids the calls altogether:
+double sqrt_sum(Vector& v)
+{
+    return sqrt_sum(v.data(),v.size());
+}
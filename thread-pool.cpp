@@ -0,0 +1,660 @@
+// @concurrency @thread-pool @work-stealing @task @future @promise
+
+/**************************
+ * @work-stealing
+ **************************/
+
+// async() may start a new thread for each task, and starting a thread costs far more than a small task.
+// A thread pool starts its threads once and then runs tasks on them.
+// Each worker thread has its own queue of tasks (a deque):
+//  - a worker adds the tasks it spawns to the back of its own deque and takes its next task from the back,
+//    so that it works on what is hot in its cache, without contention;
+//  - a worker that runs out of work steals from the front of another worker's deque,
+//    taking the oldest – typically largest – task, so that work spreads out without central coordination.
+// That's called work stealing.
+
+// A Task is a function object that is run once; unlike function<void()>, it can hold move-only things
+class Task {
+public:
+    Task() = default;
+    template<typename F>
+    Task(F f) :p{make_unique<Impl<F>>(std::move(f))} {}
+    void operator()() { p->run(); }
+    explicit operator bool() const { return p!=nullptr; }
+private:
+    struct Base {
+        virtual void run() = 0;
+        virtual ~Base() = default;
+    };
+    template<typename F>
+    struct Impl : Base {
+        F f;
+        Impl(F ff) :f{std::move(ff)} {}
+        void run() override { f(); }
+    };
+    unique_ptr<Base> p;
+};
+
+template<typename T>
+class Future;
+
+class Thread_pool {
+public:
+    explicit Thread_pool(unsigned n = max(thread::hardware_concurrency(),1u));
+    ~Thread_pool();                          // run the remaining tasks, then stop the workers
+
+    Thread_pool(const Thread_pool&) = delete;
+    Thread_pool& operator=(const Thread_pool&) = delete;
+
+    template<typename F>
+    auto submit(F f) -> Future<invoke_result_t<F>>;    // run f() on a worker
+
+    void post(Task t);                       // run t on a worker; nobody waits for a result
+    bool run_one();                          // run a pending task on the calling thread; false if none was found
+    unsigned size() const { return workers.size(); }
+private:
+    struct Worker_queue {
+        mutex m;
+        deque<Task> tasks;
+    };
+
+    void work(unsigned i);                   // the loop of worker i
+    Task find_task(unsigned i);              // our own newest, or someone else's oldest, task
+
+    vector<unique_ptr<Worker_queue>> queues;
+    vector<thread> workers;
+    atomic<unsigned> next_queue {0};         // where tasks from outside the pool go (round robin)
+
+    // Idle workers sleep on a counter of submitted tasks, as in Ring_queue (@waiting-for-events)
+    atomic<unsigned> submitted {0};
+    atomic<int> sleepers {0};
+    atomic<bool> done {false};
+
+    static inline thread_local Thread_pool* current_pool = nullptr;   // the pool the calling thread works for
+    static inline thread_local unsigned current_index = 0;             // and its queue there
+};
+
+Thread_pool::Thread_pool(unsigned n)
+{
+    for (unsigned i = 0; i!=n; ++i)
+        queues.push_back(make_unique<Worker_queue>());
+    for (unsigned i = 0; i!=n; ++i)
+        workers.emplace_back([this,i] { work(i); });
+}
+
+Thread_pool::~Thread_pool()
+{
+    done = true;
+    submitted.fetch_add(1);
+    submitted.notify_all();
+    for (auto& t : workers)
+        t.join();
+}
+
+void Thread_pool::post(Task t)
+{
+    // A worker pushes onto its own deque; anyone else spreads the work around
+    const unsigned i = current_pool==this ? current_index : next_queue.fetch_add(1,memory_order_relaxed)%queues.size();
+    {
+        scoped_lock lck {queues[i]->m};
+        queues[i]->tasks.push_back(std::move(t));
+    }
+    submitted.fetch_add(1);
+    if (sleepers.load()!=0)
+        submitted.notify_one();
+}
+
+Task Thread_pool::find_task(unsigned i)
+{
+    {
+        Worker_queue& own = *queues[i];
+        scoped_lock lck {own.m};
+        if (!own.tasks.empty()) {
+            Task t = std::move(own.tasks.back());    // newest first: its data is likely in our cache
+            own.tasks.pop_back();
+            return t;
+        }
+    }
+    for (unsigned k = 1; k!=queues.size(); ++k) {
+        Worker_queue& victim = *queues[(i+k)%queues.size()];
+        scoped_lock lck {victim.m};
+        if (!victim.tasks.empty()) {
+            Task t = std::move(victim.tasks.front());   // steal the oldest
+            victim.tasks.pop_front();
+            return t;
+        }
+    }
+    return {};
+}
+
+void Thread_pool::work(unsigned i)
+{
+    current_pool = this;
+    current_index = i;
+    while (true) {
+        const unsigned s = submitted.load();
+        if (Task t = find_task(i)) {
+            t();
+            continue;
+        }
+        if (done)
+            return;                          // no work left, and no more is coming
+        sleepers.fetch_add(1);
+        if (submitted.load()==s)             // nothing submitted since we looked
+            submitted.wait(s);
+        sleepers.fetch_sub(1);
+    }
+}
+
+bool Thread_pool::run_one()
+{
+    const unsigned i = current_pool==this ? current_index : 0;
+    if (Task t = find_task(i)) {
+        t();
+        return true;
+    }
+    return false;
+}
+
+
+// Most programs need only one pool, with a thread per core:
+Thread_pool& default_pool()
+{
+    static Thread_pool pool;
+    return pool;
+}
+
+// Note that a task waiting in get() helps only while there are tasks to run;
+// a task that blocks on something else (a lock, I/O) still ties up its worker.
+
+/**************************
+ * @promise
+ **************************/
+
+// A promise<X>/future<X> pair (@communicating-tasks) shares a state allocated on the free store for each task.
+// For a task that runs for a microsecond, that allocation, and its deallocation on another thread, is a large part of the cost.
+// The state doesn't have to come from the free store. We can provide the same set_value()/set_exception()/get() interface
+// with a Shared_state that is either
+//  - a local variable of the function that waits for the result (“inline”), or
+//  - taken from a State_pool of recycled states (“pooled”), for when the result may outlive that function.
+template<typename T>
+class State_pool;
+
+// A continuation is a task to be posted to a pool once a result is ready (see @continuations).
+// A pooled state keeps a list of them; the list is closed by setting its head to no_more_continuations
+// when the result arrives, so that a continuation added later is posted immediately.
+struct Continuation {
+    Task task;
+    Thread_pool* pool;
+    Continuation* next;
+};
+
+inline Continuation no_more_continuations;
+
+template<typename T>
+class Shared_state {
+public:
+    using Value = conditional_t<is_void_v<T>,monostate,T>;
+
+    Shared_state() = default;
+    ~Shared_state() { if (uses.load()!=0) wait_until_done(); }   // an inline state must not die while a Promise still writes to it
+
+    Shared_state(const Shared_state&) = delete;
+    Shared_state& operator=(const Shared_state&) = delete;
+
+    bool is_ready() const { return ready.load(memory_order_acquire)!=empty; }
+private:
+    template<typename> friend class Promise;
+    template<typename> friend class Future;
+    friend class State_pool<T>;
+
+    // set_value() and set_exception() store the result, mark the state set, wake waiters, and finally mark it done;
+    // after that, the setter doesn't touch an inline state, so it may be destroyed.
+    // Setting the result ends the Promise's use of the state.
+    enum Progress { empty, set, done };
+
+    void set_value(Value v) { value.emplace(std::move(v)); publish(); }
+    void set_exception(exception_ptr e) { ex = e; publish(); }
+    void publish();
+    void wait_until_done() const;
+    void release();                            // a Promise or Future stops using the state
+    void add_continuation(Task t, Thread_pool* pool);
+    void run_continuations();
+
+    atomic<int> ready {empty};
+    optional<Value> value;
+    exception_ptr ex;
+    atomic<int> uses {0};                      // Promises and Futures using a pooled state; 1 once an inline state has a Promise
+    State_pool<T>* home = nullptr;             // nullptr for an inline state
+    atomic<Continuation*> continuations {nullptr};   // only for a pooled state
+};
+
+template<typename T>
+void Shared_state<T>::publish()
+{
+    State_pool<T>* h = home;                   // read it now: once we are done, an inline state may be gone
+    ready.store(set,memory_order_release);
+    ready.notify_all();
+    ready.store(done,memory_order_release);
+    if (h) {
+        run_continuations();
+        release();
+    }
+}
+
+template<typename T>
+void Shared_state<T>::wait_until_done() const
+{
+    if (ready.load(memory_order_acquire)==done)
+        return;
+    ready.wait(empty,memory_order_acquire);
+    while (ready.load(memory_order_acquire)!=done)     // only the few instructions between notify and done
+        this_thread::yield();
+}
+
+// States are allocated in slabs and recycled through a free list, so a steady stream of tasks doesn't allocate at all.
+// Each type of result has its own pool; a lock is much cheaper than an allocation when uncontended:
+template<typename T>
+class State_pool {
+public:
+    static State_pool& instance()
+    {
+        static State_pool* p = new State_pool;   // never destroyed: states may be released during static destruction
+        return *p;
+    }
+
+    Shared_state<T>* get();
+    void put(Shared_state<T>* s);
+private:
+    static constexpr int slab_size = 64;
+
+    mutex m;
+    vector<Shared_state<T>*> free;
+    vector<unique_ptr<Shared_state<T>[]>> slabs;
+};
+
+template<typename T>
+Shared_state<T>* State_pool<T>::get()
+{
+    scoped_lock lck {m};
+    if (free.empty()) {
+        slabs.push_back(make_unique<Shared_state<T>[]>(slab_size));
+        for (int i = 0; i!=slab_size; ++i) {
+            slabs.back()[i].home = this;
+            free.push_back(&slabs.back()[i]);
+        }
+    }
+    Shared_state<T>* s = free.back();
+    free.pop_back();
+    return s;
+}
+
+template<typename T>
+void State_pool<T>::put(Shared_state<T>* s)
+{
+    s->value.reset();                          // don't keep the result alive in the free list
+    s->ex = nullptr;
+    s->continuations.store(nullptr,memory_order_relaxed);
+    s->ready.store(Shared_state<T>::empty,memory_order_relaxed);
+    scoped_lock lck {m};
+    free.push_back(s);
+}
+
+template<typename T>
+void Shared_state<T>::release()
+{
+    if (home && uses.fetch_sub(1,memory_order_acq_rel)==1)     // the last user recycles a pooled state
+        home->put(this);
+}
+
+// Promise and Future are resource handles for their share of a state: they can be moved, but not copied
+template<typename T>
+class Promise {
+public:
+    Promise();                                   // use a pooled state
+    explicit Promise(Shared_state<T>& s);        // use an inline state
+    ~Promise();
+
+    Promise(Promise&& p) :state{exchange(p.state,nullptr)} {}
+    Promise& operator=(Promise&& p);
+
+    Future<T> get_future(Thread_pool* helper = nullptr);   // call at most once, before setting the result
+    void set_value(typename Shared_state<T>::Value v);
+    void set_exception(exception_ptr e);
+private:
+    Shared_state<T>* state;
+};
+
+template<typename T>
+class Future {
+public:
+    Future() = default;
+    ~Future() { if (state) state->release(); }
+
+    Future(Future&& f) :state{exchange(f.state,nullptr)}, helper{f.helper} {}
+    Future& operator=(Future&& f);
+
+    bool valid() const { return state!=nullptr; }
+    bool is_ready() const { return state->is_ready(); }
+    T get();            // wait (helping the pool we came from, if any); then return the value or throw; call at most once
+
+    // see @continuations; the state must be pooled
+    template<typename F>
+    auto then(F f) && -> Future<invoke_result_t<F,Future<T>>>;                    // f(ready future) on our pool
+    template<typename F>
+    auto then(F f, Thread_pool& pool) && -> Future<invoke_result_t<F,Future<T>>>;
+    void on_ready(Task t, Thread_pool& pool);   // post t to pool once the result is there
+private:
+    friend class Promise<T>;
+    Future(Shared_state<T>* s, Thread_pool* p) :state{s}, helper{p} {}
+
+    Shared_state<T>* state = nullptr;
+    Thread_pool* helper = nullptr;
+};
+
+template<typename T>
+Promise<T>::Promise()
+    :state{State_pool<T>::instance().get()}
+{
+    state->uses.store(2,memory_order_relaxed);  // this Promise and its Future
+}
+
+template<typename T>
+Promise<T>::Promise(Shared_state<T>& s)
+    :state{&s}
+{
+    s.uses.store(1,memory_order_relaxed);
+}
+
+// As for promise, destroying a Promise without setting a result passes broken_promise to the Future:
+template<typename T>
+Promise<T>::~Promise()
+{
+    if (state)
+        state->set_exception(make_exception_ptr(future_error{future_errc::broken_promise}));
+}
+
+template<typename T>
+Promise<T>& Promise<T>::operator=(Promise&& p)
+{
+    Promise tmp {std::move(*this)};              // release our state (if any) as a destructor would
+    state = exchange(p.state,nullptr);
+    return *this;
+}
+
+template<typename T>
+Future<T> Promise<T>::get_future(Thread_pool* helper)
+{
+    return {state,helper};
+}
+
+template<typename T>
+void Promise<T>::set_value(typename Shared_state<T>::Value v)
+{
+    exchange(state,nullptr)->set_value(std::move(v));     // we are done with the state
+}
+
+template<typename T>
+void Promise<T>::set_exception(exception_ptr e)
+{
+    exchange(state,nullptr)->set_exception(e);
+}
+
+template<typename T>
+Future<T>& Future<T>::operator=(Future&& f)
+{
+    if (this!=&f) {
+        if (state)
+            state->release();
+        state = exchange(f.state,nullptr);
+        helper = f.helper;
+    }
+    return *this;
+}
+
+template<typename T>
+T Future<T>::get()
+{
+    while (!is_ready()) {
+        if (helper && helper->run_one())       // help rather than block
+            continue;
+        state->ready.wait(Shared_state<T>::empty,memory_order_acquire);
+    }
+    if (state->ex)
+        rethrow_exception(state->ex);
+    if constexpr (!is_void_v<T>)
+        return std::move(*state->value);
+}
+
+// Set p's value to the result of f(), or pass on the exception f() throws
+template<typename R, typename F>
+void set_result(Promise<R>& p, F& f)
+{
+    try {
+        if constexpr (is_void_v<R>) {
+            f();
+            p.set_value({});
+        }
+        else
+            p.set_value(f());
+    }
+    catch (...) {
+        p.set_exception(current_exception());
+    }
+}
+
+// Thread_pool::submit() gives each task a pooled state; the Future's get() helps the pool while it waits
+template<typename F>
+auto Thread_pool::submit(F f) -> Future<invoke_result_t<F>>
+{
+    using R = invoke_result_t<F>;
+    Promise<R> p;
+    Future<R> res = p.get_future(this);
+    post([p = std::move(p),f = std::move(f)]() mutable { set_result(p,f); });
+    return res;
+}
+
+// When the result is used in the function that started the task, the state can be a local variable:
+double sum_halves(Thread_pool& pool, const vector<double>& v)
+{
+    Shared_state<double> s;                      // inline: no allocation for the state
+    Promise<double> p {s};
+    Future<double> f = p.get_future(&pool);
+    const size_t half = v.size()/2;
+    pool.post([&v,half,p = std::move(p)]() mutable {
+        p.set_value(accumulate(v.begin(),v.begin()+half,0.0));
+    });
+    double rest = accumulate(v.begin()+half,v.end(),0.0);
+    return f.get()+rest;
+}   // were we to leave by an exception, ~Shared_state() would wait for the task to finish with s
+
+// The latency of starting a task and waiting for its result, using std::promise and the two kinds of Shared_state:
+template<typename Spawn>
+void time_spawn(const char* name, Spawn spawn_and_join, int n)
+{
+    auto t0 = high_resolution_clock::now();
+    long long sum = 0;
+    for (int i = 0; i!=n; ++i)
+        sum += spawn_and_join(i);
+    auto t1 = high_resolution_clock::now();
+    cout << name << ": " << duration_cast<nanoseconds>(t1-t0).count()/n << "ns per task (" << sum << ")\n";
+}
+
+void spawn_benchmark(Thread_pool& pool = default_pool())
+{
+    const int n = 1'000'000;
+    time_spawn("std::promise",[&](int i) {
+        promise<int> p;
+        future<int> f = p.get_future();
+        pool.post([p = std::move(p),i]() mutable { p.set_value(i); });
+        return f.get();
+    },n);
+    time_spawn("Promise, pooled state",[&](int i) {
+        Promise<int> p;
+        Future<int> f = p.get_future(&pool);
+        pool.post([p = std::move(p),i]() mutable { p.set_value(i); });
+        return f.get();
+    },n);
+    time_spawn("Promise, inline state",[&](int i) {
+        Shared_state<int> s;
+        Promise<int> p {s};
+        Future<int> f = p.get_future(&pool);
+        pool.post([p = std::move(p),i]() mutable { p.set_value(i); });
+        return f.get();
+    },n);
+}
+// All three still allocate the Task that carries the work to the pool.
+// Beyond the state, a Future differs from a future in that get() may run the task itself rather than sleep until a worker has done it;
+// with few cores, that saves more than the allocation does.
+
+/**************************
+ * @continuations
+ **************************/
+
+// get() makes the caller wait. If the caller is a pool worker and there is nothing to help with,
+// or the caller isn't a worker, a thread is tied up doing nothing until the result arrives.
+// Instead, we can say what to do with a result when it arrives – a continuation – and return at once:
+//     Future<string> fs = pool.submit(fetch).then([](Future<Page> f) { return title(f.get()); });
+// The continuation is given the ready Future, so it can get() the value or deal with the exception.
+// Once posted, the continuation runs on a pool like any other task; nobody blocks.
+
+template<typename T>
+void Shared_state<T>::add_continuation(Task t, Thread_pool* pool)
+{
+    auto c = make_unique<Continuation>(Continuation{std::move(t),pool,continuations.load(memory_order_acquire)});
+    while (c->next!=&no_more_continuations)
+        if (continuations.compare_exchange_weak(c->next,c.get(),memory_order_acq_rel,memory_order_acquire)) {
+            c.release();                       // now owned by the list
+            return;
+        }
+    pool->post(std::move(c->task));           // the result is already there
+}
+
+// Continuations are only ever pushed, and the list is taken as a whole, so there is no ABA problem
+template<typename T>
+void Shared_state<T>::run_continuations()
+{
+    Continuation* c = continuations.exchange(&no_more_continuations,memory_order_acq_rel);
+    while (c) {
+        unique_ptr<Continuation> p {c};
+        c = c->next;
+        p->pool->post(std::move(p->task));
+    }
+}
+
+// An inline state can't have continuations: it may be gone as soon as its result is set
+template<typename T>
+void Future<T>::on_ready(Task t, Thread_pool& pool)
+{
+    if (!state->home)
+        throw logic_error{"Future::on_ready(): continuation on an inline Shared_state"};
+    state->add_continuation(std::move(t),&pool);
+}
+
+template<typename T>
+template<typename F>
+auto Future<T>::then(F f) && -> Future<invoke_result_t<F,Future<T>>>
+{
+    return std::move(*this).then(std::move(f),helper ? *helper : default_pool());
+}
+
+// then() consumes the Future: the continuation owns it until it runs
+template<typename T>
+template<typename F>
+auto Future<T>::then(F f, Thread_pool& pool) && -> Future<invoke_result_t<F,Future<T>>>
+{
+    using R = invoke_result_t<F,Future<T>>;
+    Promise<R> p;
+    Future<R> res = p.get_future(&pool);
+    if (!state->home)
+        throw logic_error{"Future::then(): continuation on an inline Shared_state"};
+    Shared_state<T>* s = state;                 // *this is about to be moved into the continuation
+    s->add_continuation([self = std::move(*this),p = std::move(p),f = std::move(f)]() mutable {
+        auto g = [&] { return f(std::move(self)); };
+        set_result(p,g);
+    },&pool);
+    return res;
+}
+
+// when_all() gives a Future that is ready when all of the futures are, and holds them.
+// The futures are given back, rather than their values, so that each can be asked for its value or exception.
+template<typename T>
+Future<vector<Future<T>>> when_all(vector<Future<T>> fs, Thread_pool& pool = default_pool())
+{
+    struct All {
+        vector<Future<T>> fs;
+        atomic<size_t> left;
+        Promise<vector<Future<T>>> p;
+    };
+    auto all = make_shared<All>();
+    all->fs = std::move(fs);
+    all->left = all->fs.size()+1;              // +1 for the registration below: fs must not be moved while we use it
+    Future<vector<Future<T>>> res = all->p.get_future(&pool);
+
+    auto arrived = [all] {
+        if (all->left.fetch_sub(1,memory_order_acq_rel)==1)   // the last one hands over the futures
+            all->p.set_value(std::move(all->fs));
+    };
+    for (auto& f : all->fs)
+        f.on_ready(arrived,pool);
+    arrived();
+    return res;
+}
+
+// when_any() gives a Future that is ready when one of the futures is; index says which one
+template<typename T>
+struct When_any_result {
+    size_t index;
+    vector<Future<T>> futures;
+};
+
+template<typename T>
+Future<When_any_result<T>> when_any(vector<Future<T>> fs, Thread_pool& pool = default_pool())
+{
+    struct Any {
+        vector<Future<T>> fs;
+        atomic<size_t> first {size_t(-1)};    // the index of the first ready future
+        atomic<int> steps {2};                 // a first result has arrived, and the registration is complete
+        Promise<When_any_result<T>> p;
+
+        void step()
+        {
+            if (steps.fetch_sub(1,memory_order_acq_rel)==1)
+                p.set_value({first.load(),std::move(fs)});
+        }
+    };
+    auto any = make_shared<Any>();
+    any->fs = std::move(fs);
+    Future<When_any_result<T>> res = any->p.get_future(&pool);
+
+    for (size_t i = 0; i!=any->fs.size(); ++i)
+        any->fs[i].on_ready([any,i] {
+            size_t none = size_t(-1);
+            if (any->first.compare_exchange_strong(none,i))
+                any->step();                   // only the first to arrive counts
+        },pool);
+    if (any->fs.empty())
+        any->step();                           // nothing to wait for: index is size_t(-1)
+    any->step();
+    return res;
+}
+
+// A request handler can now describe the whole computation up front.
+// Here, we ask two replicas and answer from whichever responds first, then log when both have:
+string query(int replica, const string& q);   // talk to a replica; might take long
+
+Future<string> hedged_query(const string& q, Thread_pool& pool = default_pool())
+{
+    vector<Future<string>> replies;
+    replies.push_back(pool.submit([q] { return query(0,q); }));
+    replies.push_back(pool.submit([q] { return query(1,q); }));
+    return when_any(std::move(replies),pool).then([&pool](Future<When_any_result<string>> f) {
+        auto [i,replies] = f.get();
+        string answer = replies[i].get();
+        replies.erase(replies.begin()+i);
+        when_all(std::move(replies),pool).then([](auto) { clog << "all replicas answered\n"; });
+        return answer;
+    });
+}
+// Note that a Future returned by then() that nobody keeps (as for the logging above) is fine:
+// the continuation still runs; only its result is dropped.
@@ -50,15 +50,65 @@ void input()
 }
 
 // The standard-library vector is implemented so that growing a vector by repeated push_back()s is efficient.
+// How much to grow by is a policy decision: doubling keeps push_back() amortized constant time,
+// but right after a reallocation up to half of the allocated space is unused.
+// For very large vectors, a smaller growth factor, fixed-size chunks, or exact growth may be a better trade-off,
+// so we make the growth strategy a template argument.
+// A growth policy maps the current capacity and the needed size to a new capacity:
+struct Double_growth {
+     static int next(int cap, int need) { return max(need, cap==0 ? 8 : 2*cap); }    // double the capacity
+};
+
+struct Half_growth {
+     static int next(int cap, int need) { return max(need, cap==0 ? 8 : cap+cap/2); }  // grow by 1.5
+};
+
+template<int N>
+struct Chunk_growth {
+     static int next(int, int need) { return (need+N-1)/N*N; }     // round up to a multiple of N
+};
+
+struct Exact_growth {
+     static int next(int, int need) { return need; }               // never allocate unused space
+};
+
+// To choose a policy for a workload, we need numbers rather than guesses, so each Vector counts its own reallocations:
+struct Vector_stats {
+     int reallocations = 0;          // number of times reserve() acquired new memory
+     long long bytes_moved = 0;      // bytes of elements moved to new memory
+     long long peak_slack = 0;       // largest number of allocated, but unused, bytes
+};
+
+// Moving an element to new memory and destroying the original is called relocation.
+// For many types, such as double or a struct of ints, relocation is just copying the bytes,
+// so reserve() can use memcpy() or even let realloc() grow the allocation in place
+// (for large blocks, realloc() typically remaps pages rather than copying them).
+// By default, a trivially copyable type is trivially relocatable;
+// a type that is relocatable, but not trivially copyable, can say so by specializing the trait.
+// Note that Entry is not: its string may point into itself (the short string optimization).
+template<typename T>
+struct is_trivially_relocatable : bool_constant<is_trivially_copyable_v<T>> {};
+
 template<typename T>
+constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+template<typename T, typename Growth = Double_growth>
 class Vector {
-     T* elem;     // pointer to first element
-     T* space;    // pointer to first unused (and uninitialized) slot
-     T* last;     // pointer to last slot
+     T* elem = nullptr;     // pointer to first element
+     T* space = nullptr;    // pointer to first unused (and uninitialized) slot
+     T* last = nullptr;     // pointer to last slot
+     Vector_stats st;
 public:
+     Vector() = default;
+     ~Vector() { destroy(elem,space); free(elem); }
+
+     // A Vector owns its elements, so the default (memberwise) copy would destroy and free them twice
+     Vector(const Vector&) = delete;
+     Vector& operator=(const Vector&) = delete;
+     // ... move operations
      // ...
-     int size();                     // number of elements (space-elem)
-     int capacity();                 // number of slots available for elements (last-elem)
+     int size() const { return space-elem; }          // number of elements (space-elem)
+     int capacity() const { return last-elem; }       // number of slots available for elements (last-elem)
      // ...
      // The reserve() is used by users of vector and other vector members to make room for more elements.
      // It may have to allocate new memory and when it does, it moves the elements to the new allocation.
@@ -67,17 +117,164 @@ public:
      // ...
      void push_back(const T& t);     // copy t into Vector
      void push_back(T&& t);          // move t into Vector
+
+     const Vector_stats& stats() const { return st; }
+private:
+     void relocate(T* p, int newsz);                   // move the elements into p and release the old space
+     void adopt(T* p, int sz, int newsz);              // p, holding sz elements, is our new space
+     template<typename Arg>
+     void grow_and_push(Arg&& x);                     // grow as the policy says, and add x at the end
 };
 
-template<typename T>
-void Vector<T>::push_back(const T& t)
+template<typename T, typename Growth>
+void Vector<T,Growth>::reserve(int newsz)
+{
+     if (newsz<=capacity())                           // never decrease allocation
+           return;
+     if constexpr (is_trivially_relocatable_v<T>) {
+           // bulk relocation: realloc() grows in place if it can and copies the bytes if it can't
+           const int sz = size();
+           T* p = static_cast<T*>(realloc(elem,newsz*sizeof(T)));
+           if (!p)
+                 throw bad_alloc{};
+           adopt(p,sz,newsz);
+     }
+     else {
+           T* p = static_cast<T*>(malloc(newsz*sizeof(T)));    // allocate uninitialized space
+           if (!p)
+                 throw bad_alloc{};
+           try {
+                 relocate(p,newsz);
+           }
+           catch (...) {
+                 free(p);
+                 throw;
+           }
+     }
+}
+
+template<typename T, typename Growth>
+void Vector<T,Growth>::relocate(T* p, int newsz)
+{
+     const int sz = size();
+     uninitialized_move(elem,space,p);                // move elements into the new space; if a move throws, nothing has changed
+     destroy(elem,space);                             // destroy the moved-from elements
+     free(elem);
+     adopt(p,sz,newsz);
+}
+
+template<typename T, typename Growth>
+void Vector<T,Growth>::adopt(T* p, int sz, int newsz)
+{
+     elem = p;
+     space = p+sz;
+     last = p+newsz;
+
+     ++st.reallocations;
+     st.bytes_moved += sz*sizeof(T);
+     st.peak_slack = max<long long>(st.peak_slack,(newsz-sz)*sizeof(T));
+}
+
+// In v.push_back(v[0]), t refers to one of our elements,
+// so when we must grow, the new element is made before the old ones are relocated:
+template<typename T, typename Growth>
+template<typename Arg>
+void Vector<T,Growth>::grow_and_push(Arg&& x)
 {
-     if (capacity()<size()+1)             // make sure we have space for t
-           reserve(size()==0?8:2*size()); // double the capacity
-     new(space) T{t};                     // initialize *space to t
+     const int sz = size();
+     const int newsz = Growth::next(capacity(),sz+1);
+     if constexpr (is_trivially_relocatable_v<T>) {
+           T tmp {std::forward<Arg>(x)};              // realloc() may free x's memory; relocating tmp is cheap
+           reserve(newsz);
+           new(space) T{std::move(tmp)};
+     }
+     else {
+           T* p = static_cast<T*>(malloc(newsz*sizeof(T)));
+           if (!p)
+                 throw bad_alloc{};
+           try {
+                 new(p+sz) T{std::forward<Arg>(x)};   // construct the new element in the new space
+           }
+           catch (...) {
+                 free(p);
+                 throw;
+           }
+           try {
+                 relocate(p,newsz);
+           }
+           catch (...) {
+                 destroy_at(p+sz);
+                 free(p);
+                 throw;
+           }
+     }
      ++space;
 }
 
+template<typename T, typename Growth>
+void Vector<T,Growth>::push_back(const T& t)
+{
+     if (capacity()<size()+1) {                       // no space for t
+           grow_and_push(t);                          // grow as the policy says
+           return;
+     }
+     new(space) T{t};                                 // initialize *space to t
+     ++space;
+}
+
+template<typename T, typename Growth>
+void Vector<T,Growth>::push_back(T&& t)
+{
+     if (capacity()<size()+1) {
+           grow_and_push(std::move(t));
+           return;
+     }
+     new(space) T{std::move(t)};                      // move t into *space
+     ++space;
+}
+
+// For a 100M element ingest, we can now try the policies and compare the numbers:
+template<typename Growth>
+void ingest(istream& is)
+{
+     Vector<double,Growth> v;
+     for (double d; is>>d;)
+           v.push_back(d);
+     const auto& s = v.stats();
+     cout << s.reallocations << " reallocations, "
+          << s.bytes_moved << " bytes moved, "
+          << s.peak_slack << " bytes peak slack\n";
+}
+
+// To see what relocation buys us, compare against a type that opts out of the fast path:
+struct Boxed {
+     double d;
+};
+
+template<>
+struct is_trivially_relocatable<Boxed> : false_type {};     // force element-wise moves
+
+template<typename T>
+void time_push_back(long long n)
+{
+     auto t0 = high_resolution_clock::now();
+     Vector<T> v;
+     for (long long i = 0; i!=n; ++i)
+           v.push_back(T{double(i)});
+     auto t1 = high_resolution_clock::now();
+     cout << n << " elements: " << duration_cast<milliseconds>(t1-t0).count() << "msec, "
+          << v.stats().bytes_moved << " bytes moved\n";
+}
+
+void relocation_benchmark()
+{
+     for (long long n = 1'000'000; n<=1'000'000'000; n *= 10) {
+           time_push_back<double>(n);      // realloc()
+           time_push_back<Boxed>(n);       // element-wise move
+     }
+}
+// Note that bytes_moved counts the same for both; the difference is in how the bytes are moved.
+
 // A vector can be copied in assignments and initializations.
 // Copying and moving of vectors are implemented by constructors and assignment operators
 // Where copying is undesirable, references or pointers or move operations should be used.
@@ -116,21 +313,85 @@ void silly(vector<Entry>& book)
 
 // I often use a simple range-checking adaptation of vector
 // If you can use vector::at() directly in your code, you don’t need my Vec workaround.
-template<typename T>
+// How much checking we want differs between testing, production canaries, and production,
+// so Vec takes the checking strategy as a template argument.
+// A checking policy checks a subscript (check()) and a subrange [b:e) (check_range()) against a size n:
+struct Unchecked {                      // no checking: as fast as vector
+    static void check(int, int) {}
+    static void check_range(int, int, int) {}
+};
+
+struct Assert_check {                   // checked in debug builds only
+    static void check(int i, int n) { assert(0<=i && i<n); }
+    static void check_range(int b, int e, int n) { assert(0<=b && b<=e && e<=n); }
+};
+
+struct Throw_check {                    // always checked; as vector::at()
+    static void check(int i, int n)
+    {
+        if (i<0 || n<=i)
+            throw out_of_range{"Vec::operator[]"};
+    }
+    static void check_range(int b, int e, int n)
+    {
+        if (b<0 || e<b || n<e)
+            throw out_of_range{"Vec::range()"};
+    }
+};
+
+// Checking only every Nth subscript catches systematic range errors at a fraction of the cost.
+// Subranges are always checked: that's one check per loop, not one per element.
+template<int N>
+struct Sampled_check {
+    static inline thread_local unsigned count = 0;
+    static void check(int i, int n)
+    {
+        if (++count%N==0)
+            Throw_check::check(i,n);
+    }
+    static void check_range(int b, int e, int n) { Throw_check::check_range(b,e,n); }
+};
+
+template<typename T, typename Check = Throw_check>
 // Vec inherits everything from vector except for the subscript operations that it redefines to do range checking.
 class Vec : public std::vector<T> {
 public:
     using vector<T>::vector;                // use the constructors from vector (under the name Vec)
 
     T& operator[](int i)                    // range check
-        // The at() operation is a vector subscript operation that 
+        // Throw_check does what at() does: 
         // throws an exception of type out_of_range if its argument is out of the vector’s range.
-        { return vector<T>::at(i); }
+        { Check::check(i,this->size()); return vector<T>::operator[](i); }
 
     const T& operator[](int i) const        // range check const objects; 
-        { return vector<T>::at(i); }
+        { Check::check(i,this->size()); return vector<T>::operator[](i); }
+
+    // For a loop, we can check the whole range once and then access the elements unchecked:
+    span<T> range(int b, int e)
+        { Check::check_range(b,e,this->size()); return {this->data()+b,this->data()+e}; }
+
+    span<const T> range(int b, int e) const
+        { Check::check_range(b,e,this->size()); return {this->data()+b,this->data()+e}; }
 };
 
+// One check instead of e-b checks:
+double sum(const Vec<double>& v, int b, int e)
+{
+    double s = 0;
+    for (double x : v.range(b,e))          // throws here if [b:e) is not in v
+        s += x;
+    return s;
+}
+
+// A build can pick its policy in one place:
+#ifdef CANARY
+template<typename T>
+using Checked_vec = Vec<T,Sampled_check<64>>;
+#else
+template<typename T>
+using Checked_vec = Vec<T,Assert_check>;
+#endif
+
 // For Vec, an out-of-range access will throw an exception that the user can catch.
 void checked(Vec<Entry>& book)
 {
@@ -42,7 +42,7 @@ void consumer()
         mcond.wait(lck,[] { return !mqueue.empty(); });    // release lck and wait;
                                                            // re-acquire lck upon wakeup
                                                            // don't wake up unless mqueue is non-empty
-        auto m = mqueue.front();           // get the message
+        auto m = std::move(mqueue.front());    // get the message (move, don't copy: a Message may be large)
         mqueue.pop();
         lck.unlock();                      // release lck
         // ... process m ...
@@ -56,8 +56,631 @@ void producer()
           Message m;
           // ... fill the message ...
           scoped_lock lck {mmutex};      // protect operations
-          mqueue.push(m);
+          mqueue.push(std::move(m));     // we don't need m any more
           mcond.notify_one();            // notify
      }                                   // release lock (at end of scope)
 }
 
+/**************************
+ * @lock-free-queue
+ **************************/
+
+// At high message rates, all producers and consumers contend for mmutex.
+// A bounded ring buffer lets them coordinate through atomic operations on two counters instead:
+// a producer claims the next slot to write and a consumer the next slot to read.
+// Each slot carries a sequence number telling whether it is ready to be written or read in the current round,
+// so a producer never overwrites an unread Message and a consumer never reads a half-written one.
+// Messages are moved in and out; a Ring_queue never copies.
+template<typename T>
+class Ring_queue {
+public:
+    explicit Ring_queue(size_t capacity);    // capacity is rounded up to a power of two
+    ~Ring_queue();
+
+    Ring_queue(const Ring_queue&) = delete;
+    Ring_queue& operator=(const Ring_queue&) = delete;
+
+    bool try_push(T&& x);                    // false if the queue is full; x is then untouched
+    bool try_pop(T& x);                      // false if the queue is empty
+    void push(T&& x);                        // wait while the queue is full
+    T pop();                                 // wait while the queue is empty
+
+    // Bulk operations claim a whole range of slots with a single compare_exchange:
+    int try_push_bulk(T* first, int n);      // move up to n elements from first; return how many were pushed
+    int try_pop_bulk(T* out, int n);         // move up to n elements to out; return how many were popped
+    void push_bulk(T* first, int n);         // push all n, waiting as needed
+    int pop_bulk(T* out, int n);             // wait for at least one element; pop up to n
+private:
+    struct Slot {
+        atomic<size_t> seq;                  // pos: free for the push at pos; pos+1: holds the value pushed at pos
+        alignas(T) byte value[sizeof(T)];    // a T lives here only between a push and its pop
+        T* get() { return reinterpret_cast<T*>(value); }
+    };
+
+    // Waiting: spin a little (the other side is usually just about to act), then sleep.
+    // The counters count completed operations; a sleeper waits for its counter to change.
+    template<typename Try>
+    void wait_for(Try try_op, atomic<unsigned>& done, atomic<int>& sleepers);
+    void wake(atomic<unsigned>& done, atomic<int>& sleepers);
+    size_t claim(atomic<size_t>& pos, size_t ready, int& n);   // claim up to n consecutive ready slots
+
+    unique_ptr<Slot[]> slots;
+    size_t mask;
+    // The counters are written by different threads, so keep them on separate cache lines
+    alignas(64) atomic<size_t> push_pos {0};
+    alignas(64) atomic<size_t> pop_pos {0};
+    alignas(64) atomic<unsigned> pushes {0};
+    atomic<int> pop_sleepers {0};
+    alignas(64) atomic<unsigned> pops {0};
+    atomic<int> push_sleepers {0};
+};
+
+template<typename T>
+Ring_queue<T>::Ring_queue(size_t capacity)
+    :slots{new Slot[bit_ceil(max<size_t>(capacity,2))]}, mask{bit_ceil(max<size_t>(capacity,2))-1}
+{
+    for (size_t i = 0; i<=mask; ++i)
+        slots[i].seq.store(i,memory_order_relaxed);
+}
+
+template<typename T>
+Ring_queue<T>::~Ring_queue()
+{
+    for (T x; try_pop(x);)                   // destroy the Messages nobody popped
+        ;
+}
+
+template<typename T>
+bool Ring_queue<T>::try_push(T&& x)
+{
+    size_t pos = push_pos.load(memory_order_relaxed);
+    while (true) {
+        Slot& s = slots[pos&mask];
+        const size_t seq = s.seq.load(memory_order_acquire);
+        const auto diff = intptr_t(seq)-intptr_t(pos);
+        if (diff==0) {                       // the slot is free: try to claim it
+            if (push_pos.compare_exchange_weak(pos,pos+1,memory_order_relaxed))
+                break;
+        }
+        else if (diff<0)                     // the slot still holds a value from the previous round: full
+            return false;
+        else                                 // another producer claimed pos; try the next
+            pos = push_pos.load(memory_order_relaxed);
+    }
+    Slot& s = slots[pos&mask];
+    new(s.value) T{std::move(x)};
+    s.seq.store(pos+1,memory_order_release); // publish
+    wake(pushes,pop_sleepers);
+    return true;
+}
+
+template<typename T>
+bool Ring_queue<T>::try_pop(T& x)
+{
+    size_t pos = pop_pos.load(memory_order_relaxed);
+    while (true) {
+        Slot& s = slots[pos&mask];
+        const size_t seq = s.seq.load(memory_order_acquire);
+        const auto diff = intptr_t(seq)-intptr_t(pos+1);
+        if (diff==0) {                       // the slot holds a value: try to claim it
+            if (pop_pos.compare_exchange_weak(pos,pos+1,memory_order_relaxed))
+                break;
+        }
+        else if (diff<0)                     // nothing pushed here yet: empty
+            return false;
+        else
+            pos = pop_pos.load(memory_order_relaxed);
+    }
+    Slot& s = slots[pos&mask];
+    x = std::move(*s.get());
+    s.get()->~T();
+    s.seq.store(pos+mask+1,memory_order_release);   // free for the push one round later
+    wake(pops,push_sleepers);
+    return true;
+}
+
+// A sleeper announces itself before its last try, and a waker bumps the counter before looking for sleepers.
+// With sequentially consistent operations on both sides, either the sleeper's last try succeeds or the waker sees the sleeper,
+// so no wakeup is lost, and a waker with nobody to wake pays only for two atomic operations.
+template<typename T>
+template<typename Try>
+void Ring_queue<T>::wait_for(Try try_op, atomic<unsigned>& done, atomic<int>& sleepers)
+{
+    for (int i = 0; i!=100; ++i) {           // spin
+        if (try_op())
+            return;
+        this_thread::yield();
+    }
+    while (true) {                           // park
+        sleepers.fetch_add(1);
+        const unsigned d = done.load();
+        if (try_op()) {
+            sleepers.fetch_sub(1);
+            return;
+        }
+        done.wait(d);                        // sleep until done changes
+        sleepers.fetch_sub(1);
+        if (try_op())
+            return;
+    }
+}
+
+template<typename T>
+void Ring_queue<T>::wake(atomic<unsigned>& done, atomic<int>& sleepers)
+{
+    done.fetch_add(1);
+    if (sleepers.load()!=0)
+        done.notify_all();                   // sleepers that lose the race go back to sleep
+}
+
+template<typename T>
+void Ring_queue<T>::push(T&& x)
+{
+    wait_for([&] { return try_push(std::move(x)); },pops,push_sleepers);
+}
+
+template<typename T>
+T Ring_queue<T>::pop()
+{
+    T x;
+    wait_for([&] { return try_pop(x); },pushes,pop_sleepers);
+    return x;
+}
+
+// To claim a range, we look at the slots from the current position until we find one that isn't ready (or have n),
+// and then move the position past all of them at once.
+// If someone else moved the position meanwhile, the compare_exchange fails and we look again.
+// ready is 0 for pushes (a slot is ready when seq==pos) and 1 for pops (when seq==pos+1).
+template<typename T>
+size_t Ring_queue<T>::claim(atomic<size_t>& p, size_t ready, int& n)
+{
+    size_t pos = p.load(memory_order_relaxed);
+    while (true) {
+        int k = 0;
+        while (k<n && slots[(pos+k)&mask].seq.load(memory_order_acquire)==pos+k+ready)
+            ++k;
+        if (k==0 || p.compare_exchange_weak(pos,pos+k,memory_order_relaxed)) {
+            n = k;
+            return pos;
+        }
+    }
+}
+
+template<typename T>
+int Ring_queue<T>::try_push_bulk(T* first, int n)
+{
+    const size_t pos = claim(push_pos,0,n);
+    for (int i = 0; i!=n; ++i) {
+        Slot& s = slots[(pos+i)&mask];
+        new(s.value) T{std::move(first[i])};
+        s.seq.store(pos+i+1,memory_order_release);
+    }
+    if (n)
+        wake(pushes,pop_sleepers);           // one wakeup for the whole batch
+    return n;
+}
+
+template<typename T>
+int Ring_queue<T>::try_pop_bulk(T* out, int n)
+{
+    const size_t pos = claim(pop_pos,1,n);
+    for (int i = 0; i!=n; ++i) {
+        Slot& s = slots[(pos+i)&mask];
+        out[i] = std::move(*s.get());
+        s.get()->~T();
+        s.seq.store(pos+i+mask+1,memory_order_release);
+    }
+    if (n)
+        wake(pops,push_sleepers);
+    return n;
+}
+
+template<typename T>
+void Ring_queue<T>::push_bulk(T* first, int n)
+{
+    while (n) {
+        int k = 0;
+        wait_for([&] { return (k = try_push_bulk(first,n))!=0; },pops,push_sleepers);
+        first += k;
+        n -= k;
+    }
+}
+
+template<typename T>
+int Ring_queue<T>::pop_bulk(T* out, int n)
+{
+    int k = 0;
+    wait_for([&] { return (k = try_pop_bulk(out,n))!=0; },pushes,pop_sleepers);
+    return k;
+}
+
+// The consumer and producer look much as before, but there is no lock to manage:
+Ring_queue<Message> rqueue {1024};
+
+void consumer()
+{
+     while(true) {
+          auto m = rqueue.pop();             // wait for a message and move it out
+          // ... process m ...
+     }
+}
+
+void producer()
+{
+     while(true) {
+          Message m;
+          // ... fill the message ...
+          rqueue.push(std::move(m));         // wait if the consumers are 1024 messages behind
+     }
+}
+
+// To compare, run the same number of producers and consumers through each queue.
+// The mutex queue is the one we started with, packaged as a class.
+// Unless we give it a capacity, it is unbounded, like the queue<Message> it is built on.
+// A bounded Mutex_queue applies a policy when a producer finds it full:
+enum class Overflow {
+    block,            // wait for a consumer to make room: backpressure on the producer
+    drop_newest,      // discard the element being pushed
+    drop_oldest,      // discard the oldest element to make room
+    fail              // throw Queue_full
+};
+
+struct Queue_full : runtime_error {
+    int pushed;                              // how many elements of a push_bulk() went in before the queue filled up
+    explicit Queue_full(int n = 0) :runtime_error{"Mutex_queue: full"}, pushed{n} {}
+};
+
+// What a queue has been through; the waits are totals, only counted when a thread actually had to wait
+struct Queue_stats {
+    long long pushed = 0;
+    long long popped = 0;
+    long long dropped = 0;
+    size_t max_size = 0;                     // the highest occupancy seen
+    nanoseconds push_wait {0};               // time producers spent waiting for room
+    nanoseconds pop_wait {0};                // time consumers spent waiting for elements
+};
+
+template<typename T>
+class Mutex_queue {
+public:
+    explicit Mutex_queue(size_t capacity = numeric_limits<size_t>::max(), Overflow policy = Overflow::block)
+        :cap{capacity}, policy{policy}
+    {
+        if (cap==0)
+            throw invalid_argument{"Mutex_queue: capacity must be positive"};   // nothing could ever be pushed
+    }
+    Mutex_queue(const Mutex_queue&) = delete;
+    Mutex_queue& operator=(const Mutex_queue&) = delete;
+
+    bool push(T&& x)                         // false if x was dropped
+    {
+        return emplace(std::move(x));
+    }
+    template<typename... Args>
+    bool emplace(Args&&... args)             // construct the element in the queue
+    {
+        unique_lock lck {mtx};
+        if (!make_room(lck))
+            return false;
+        q.emplace(std::forward<Args>(args)...);
+        pushed(1);
+        not_empty.notify_one();
+        return true;
+    }
+    T pop()
+    {
+        unique_lock lck {mtx};
+        wait_for_element(lck);
+        T x = std::move(q.front());
+        q.pop();
+        popped(1);
+        return x;
+    }
+    int push_bulk(T* first, int n)           // return the number of elements pushed (not dropped)
+    {
+        unique_lock lck {mtx};
+        int k = 0;
+        try {
+            for (int i = 0; i!=n; ++i)
+                if (make_room(lck)) {
+                    q.push(std::move(first[i]));
+                    pushed(1);
+                    ++k;
+                }
+        }
+        catch (Queue_full&) {                // Overflow::fail: first[0..k) went in; tell consumers and the caller
+            if (k!=0)
+                not_empty.notify_all();
+            throw Queue_full{k};
+        }
+        not_empty.notify_all();              // there may be work for several consumers
+        return k;
+    }
+    int pop_bulk(T* out, int n)              // wait for at least one element; pop up to n
+    {
+        unique_lock lck {mtx};
+        wait_for_element(lck);
+        int k = 0;
+        for (; k!=n && !q.empty(); ++k) {
+            out[k] = std::move(q.front());
+            q.pop();
+        }
+        popped(k);
+        return k;
+    }
+
+    size_t size() const { scoped_lock lck {mtx}; return q.size(); }
+    Queue_stats stats() const { scoped_lock lck {mtx}; return st; }
+private:
+    bool make_room(unique_lock<mutex>& lck)  // false if the new element is to be dropped
+    {
+        if (q.size()<cap)
+            return true;
+        switch (policy) {
+        case Overflow::block:
+        {
+            not_empty.notify_all();          // make sure consumers know about what we have pushed so far
+            auto t0 = steady_clock::now();
+            not_full.wait(lck,[this] { return q.size()<cap; });
+            st.push_wait += steady_clock::now()-t0;
+            return true;
+        }
+        case Overflow::drop_newest:
+            ++st.dropped;
+            return false;
+        case Overflow::drop_oldest:
+            q.pop();
+            ++st.dropped;
+            return true;
+        case Overflow::fail:
+            throw Queue_full{};
+        }
+        return false;
+    }
+    void wait_for_element(unique_lock<mutex>& lck)
+    {
+        if (!q.empty())
+            return;                          // don't pay for reading the clock unless we wait
+        auto t0 = steady_clock::now();
+        not_empty.wait(lck,[this] { return !q.empty(); });
+        st.pop_wait += steady_clock::now()-t0;
+    }
+    void pushed(int n)
+    {
+        st.pushed += n;
+        st.max_size = max(st.max_size,q.size());
+    }
+    void popped(int n)
+    {
+        st.popped += n;
+        if (cap!=numeric_limits<size_t>::max())
+            n==1 ? not_full.notify_one() : not_full.notify_all();
+    }
+
+    queue<T> q;
+    const size_t cap;
+    const Overflow policy;
+    Queue_stats st;
+    condition_variable not_empty;
+    condition_variable not_full;
+    mutable mutex mtx;
+};
+
+template<typename Queue>
+void time_queue(const char* name, Queue& q, int pairs, int messages)
+{
+    auto t0 = high_resolution_clock::now();
+    vector<thread> threads;
+    for (int i = 0; i!=pairs; ++i) {
+        threads.emplace_back([&] { for (int n = 0; n!=messages; ++n) q.push(Message{}); });
+        threads.emplace_back([&] { for (int n = 0; n!=messages; ++n) q.pop(); });
+    }
+    for (auto& t : threads)
+        t.join();
+    auto t1 = high_resolution_clock::now();
+    cout << name << ", " << 2*pairs << " threads: "
+         << pairs*messages/(duration_cast<microseconds>(t1-t0).count()/1e6) << " messages/s\n";
+}
+
+void queue_benchmark()
+{
+    for (int pairs : {1,2,4,8,16,32}) {      // 2 to 64 threads
+        Mutex_queue<Message> mq;
+        time_queue("mutex queue",mq,pairs,1'000'000/pairs);
+        Ring_queue<Message> rq {1024};
+        time_queue("ring queue",rq,pairs,1'000'000/pairs);
+    }
+}
+
+/**************************
+ * @batching
+ **************************/
+
+// Every Message the consumer() gets costs a lock and an unlock, and possibly a wakeup.
+// When Messages arrive faster than they are processed, the consumer can just as well take all that are there (up to a limit):
+void consumer()
+{
+     constexpr int batch = 64;
+     vector<Message> ms(batch);
+     while(true) {
+          unique_lock lck {mmutex};
+          mcond.wait(lck,[] { return !mqueue.empty(); });
+          int n = 0;
+          for (; n!=batch && !mqueue.empty(); ++n) {     // drain up to batch messages under one lock
+               ms[n] = std::move(mqueue.front());
+               mqueue.pop();
+          }
+          lck.unlock();
+          for (int i = 0; i!=n; ++i) {
+               // ... process ms[i] ...
+          }
+     }
+}
+
+// Similarly, a producer that has several Messages ready can push them all under one lock, with one notification.
+// Both queue classes offer that as push_bulk() and pop_bulk():
+void producer()
+{
+     constexpr int batch = 64;
+     vector<Message> ms(batch);
+     while(true) {
+          // ... fill the messages ...
+          rqueue.push_bulk(ms.data(),batch);
+     }
+}
+
+// The gain depends on the batch size, so measure messages per second for a range of batch sizes:
+template<typename Queue>
+void time_batches(const char* name, Queue& q, int pairs, int messages, int batch)
+{
+    auto t0 = high_resolution_clock::now();
+    vector<thread> threads;
+    for (int i = 0; i!=pairs; ++i) {
+        threads.emplace_back([&] {
+            vector<Message> ms(batch);
+            for (int n = 0; n<messages; n += batch)
+                q.push_bulk(ms.data(),batch);
+        });
+        threads.emplace_back([&] {
+            vector<Message> ms(batch);
+            for (int n = 0; n<messages;)
+                n += q.pop_bulk(ms.data(),min(batch,messages-n));   // don't take another consumer's share
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    auto t1 = high_resolution_clock::now();
+    cout << name << ", batch " << batch << ": "
+         << pairs*messages/(duration_cast<microseconds>(t1-t0).count()/1e6) << " messages/s\n";
+}
+
+void batch_benchmark()
+{
+    for (int batch : {1,4,16,64,256}) {
+        Mutex_queue<Message> mq;
+        time_batches("mutex queue",mq,4,1<<20,batch);
+        Ring_queue<Message> rq {1024};
+        time_batches("ring queue",rq,4,1<<20,batch);
+    }
+}
+// Note that a consumer may pop messages pushed by different producers in one batch, so
+// with several consumers a consumer only sees messages in the order they were pushed within its own batches.
+
+/**************************
+ * @moving-messages
+ **************************/
+
+// A Message is typically a handle to its data (e.g., a vector<char> holding a payload of a few KB),
+// so copying it means allocating and copying the payload, whereas moving it means copying a few pointers.
+// A queue therefore never needs to copy:
+//  - push(std::move(m)) moves a Message that the producer filled without holding the lock;
+//  - emplace(args) constructs the Message from its arguments right in the queue;
+//  - pop() moves the Message out of the queue.
+// The queues take only rvalues, so an accidental copy doesn't compile:
+//      Message m;
+//      mq.push(m);                 // error: m is an lvalue
+//      mq.push(std::move(m));      // OK
+// Keep in mind that emplace() runs the Message's constructor under the lock;
+// for an expensive constructor, construct outside and push(std::move()).
+struct Big_message {
+     int id = 0;
+     vector<char> payload;
+};
+
+Mutex_queue<Big_message> bqueue;
+
+void producer_of_big()
+{
+     for (int id = 0; true; ++id) {
+          vector<char> payload(4096);
+          // ... fill payload, without holding any lock ...
+          bqueue.emplace(id,std::move(payload));     // constructs Big_message{id,payload} in the queue
+     }
+}
+
+void consumer_of_big()
+{
+     while(true) {
+          auto m = bqueue.pop();                     // moved out: the payload is not copied
+          // ... process m ...
+     }
+}
+
+// To measure what copying cost us, pass large Messages through the original copying queue and the moving queue:
+void time_payloads(const char* name, function<void(Big_message&)> push, function<Big_message()> pop, int messages, int size)
+{
+    auto t0 = high_resolution_clock::now();
+    thread p {[&] {
+        for (int i = 0; i!=messages; ++i) {
+            Big_message m {i,vector<char>(size)};
+            push(m);
+        }
+    }};
+    thread c {[&] {
+        for (int i = 0; i!=messages; ++i)
+            pop();
+    }};
+    p.join();
+    c.join();
+    auto t1 = high_resolution_clock::now();
+    cout << name << ", " << size << " bytes: "
+         << messages/(duration_cast<microseconds>(t1-t0).count()/1e6) << " messages/s\n";
+}
+
+void payload_benchmark()
+{
+    for (int size : {64,1024,4096,16384}) {
+        queue<Big_message> cq;                       // as in the first consumer() and producer()
+        mutex cm;
+        condition_variable ccv;
+        time_payloads("copy",
+            [&](Big_message& m) { scoped_lock lck {cm}; cq.push(m); ccv.notify_one(); },
+            [&] { unique_lock lck {cm}; ccv.wait(lck,[&] { return !cq.empty(); }); auto m = cq.front(); cq.pop(); return m; },
+            100'000,size);
+
+        Mutex_queue<Big_message> mq;
+        time_payloads("move",
+            [&](Big_message& m) { mq.push(std::move(m)); },
+            [&] { return mq.pop(); },
+            100'000,size);
+    }
+}
+
+/**************************
+ * @backpressure
+ **************************/
+
+// Our first producer() pushes into an unbounded queue, so 
+// if the consumers fall behind, the queue – and the memory used – grows until we run out.
+// A bounded queue makes the system degrade in a controlled way instead.
+// Which policy is right depends on the Messages:
+//  - block when every Message must be processed; the producer then slows to the consumers' pace;
+//  - drop_newest or drop_oldest when Messages can be lost, e.g., periodic samples where the latest matters most (drop_oldest);
+//  - fail when the producer can do something better, e.g., reject a request with "busy, try later."
+Mutex_queue<Message> bounded_queue {10'000,Overflow::block};        // at most 10,000 Messages in flight
+
+void producer()
+{
+     while(true) {
+          Message m;
+          // ... fill the message ...
+          bounded_queue.push(std::move(m));        // waits while the consumers are 10,000 Messages behind
+     }
+}
+
+// The statistics show whether the bound is hit and who waits for whom:
+void monitor()
+{
+     Queue_stats prev;
+     while(true) {
+          this_thread::sleep_for(seconds{1});
+          Queue_stats s = bounded_queue.stats();
+          cout << "occupancy " << bounded_queue.size() << " (max " << s.max_size << "), "
+               << s.pushed-prev.pushed << " pushed, " << s.popped-prev.popped << " popped, "
+               << s.dropped-prev.dropped << " dropped, "
+               << "producers waited " << duration_cast<milliseconds>(s.push_wait-prev.push_wait).count() << "ms, "
+               << "consumers waited " << duration_cast<milliseconds>(s.pop_wait-prev.pop_wait).count() << "ms\n";
+          prev = s;
+     }
+}
+// Producers waiting a lot means the consumers are the bottleneck; consumers waiting a lot means they are not.